@@ -0,0 +1,162 @@
+// 任务队列微基准：互斥锁环形队列 vs 无锁 MPMC 环形队列
+// P 个生产者线程并发 threadPoolAdd 空任务，C 个工作线程(min = max = C)消费，统计全部执行完的吞吐
+// 之后是突发负载下的延迟：先压进一批慢任务(低优先级)，再陆续提交短任务(高优先级)，
+// 比较先进先出的互斥锁队列和优先级队列下短任务从提交到开始执行的等待时间
+// 用法: ./threadpool_bench [每组任务数=1000000] [队列容量=1024]
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "threadpool.h"
+
+static atomic_long doneNum;
+
+typedef struct Producer
+{
+    ThreadPool *pool;
+    long count;
+} Producer;
+
+static void emptyTask(void *arg)
+{
+    atomic_fetch_add_explicit(&doneNum, 1, memory_order_relaxed);
+}
+
+static void *produce(void *arg)
+{
+    Producer *p = (Producer *)arg;
+    for (long i = 0; i < p->count; i++)
+    {
+        threadPoolAdd(p->pool, emptyTask, NULL);
+    }
+    return NULL;
+}
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 返回每秒完成的任务数(百万)
+static double run(int queueType, int producers, int consumers, long total, int capacity)
+{
+    ThreadPool *pool = threadPoolCreateEx(consumers, consumers, capacity, queueType);
+    pthread_t tids[64];
+    Producer args[64];
+    long per = total / producers;
+    atomic_store(&doneNum, 0);
+
+    double start = nowSec();
+    for (int i = 0; i < producers; i++)
+    {
+        args[i].pool = pool;
+        args[i].count = per;
+        pthread_create(&tids[i], NULL, produce, &args[i]);
+    }
+    for (int i = 0; i < producers; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+    while (atomic_load(&doneNum) < per * producers)
+    {
+        sched_yield();
+    }
+    double cost = nowSec() - start;
+    threadPoolDestroy(pool);
+    return per * producers / cost / 1e6;
+}
+
+#define SLOW_TASKS 200   // 突发的慢任务个数
+#define SLOW_TASK_US 2000 // 每个慢任务的耗时
+#define FAST_TASKS 40     // 突发之后陆续提交的短任务个数
+#define FAST_GAP_US 5000  // 短任务的提交间隔
+
+typedef struct FastArg
+{
+    long long submitUs;
+    long long *waitUs; // 写回排队等待时间
+} FastArg;
+
+static void slowTask(void *arg)
+{
+    usleep(SLOW_TASK_US);
+    atomic_fetch_add(&doneNum, 1);
+}
+
+static void fastTask(void *arg)
+{
+    FastArg *fast = (FastArg *)arg;
+    *fast->waitUs = prioQueueNowUs() - fast->submitUs;
+    atomic_fetch_add(&doneNum, 1);
+}
+
+static int cmpLong(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// 两个工作线程，输出短任务等待时间的平均值/p99/最大值(ms)
+static void burstLatency(int queueType, const char *name)
+{
+    static long long waits[FAST_TASKS];
+    ThreadPool *pool = threadPoolCreateEx(2, 2, 1024, queueType);
+    atomic_store(&doneNum, 0);
+    for (int i = 0; i < SLOW_TASKS; i++)
+    {
+        threadPoolAddEx(pool, slowTask, NULL, TASK_PRIO_LOW, 0);
+    }
+    for (int i = 0; i < FAST_TASKS; i++)
+    {
+        FastArg *fast = (FastArg *)malloc(sizeof(FastArg)); // 工作线程执行完会 free
+        fast->submitUs = prioQueueNowUs();
+        fast->waitUs = &waits[i];
+        threadPoolAddEx(pool, fastTask, fast, TASK_PRIO_HIGH, 0);
+        usleep(FAST_GAP_US);
+    }
+    while (atomic_load(&doneNum) < SLOW_TASKS + FAST_TASKS)
+    {
+        usleep(1000);
+    }
+    threadPoolDestroy(pool);
+
+    long long sum = 0;
+    for (int i = 0; i < FAST_TASKS; i++)
+    {
+        sum += waits[i];
+    }
+    qsort(waits, FAST_TASKS, sizeof(long long), cmpLong);
+    printf("%-10s %10.2f %10.2f %10.2f\n", name, sum / (double)FAST_TASKS / 1000, waits[FAST_TASKS * 99 / 100] / 1000.0,
+           waits[FAST_TASKS - 1] / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    long total = argc > 1 ? atol(argv[1]) : 1000000;
+    int capacity = argc > 2 ? atoi(argv[2]) : 1024;
+    int configs[][2] = {{1, 1}, {1, 4}, {4, 1}, {4, 4}, {8, 8}};
+
+    printf("tasks %ld, capacity %d (Mtasks/s)\n", total, capacity);
+    printf("%-10s %-10s %10s %10s\n", "producers", "consumers", "mutex", "lockfree");
+    for (int i = 0; i < (int)(sizeof(configs) / sizeof(configs[0])); i++)
+    {
+        int p = configs[i][0];
+        int c = configs[i][1];
+        double a = run(QUEUE_MUTEX, p, c, total, capacity);
+        double b = run(QUEUE_LOCKFREE, p, c, total, capacity);
+        printf("%-10d %-10d %10.3f %10.3f\n", p, c, a, b);
+    }
+
+    printf("\nburst of %d slow tasks (%dus), then %d high priority tasks every %dus, 2 workers (wait ms)\n", SLOW_TASKS,
+           SLOW_TASK_US, FAST_TASKS, FAST_GAP_US);
+    printf("%-10s %10s %10s %10s\n", "queue", "avg", "p99", "max");
+    burstLatency(QUEUE_MUTEX, "fifo");
+    burstLatency(QUEUE_PRIORITY, "priority");
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "prioqueue.h"
+#include <stdlib.h>
+#include <time.h>
+
+// 各级的老化时间：普通任务的有效截止时间 = 入队时间 + 这个值
+static const long long PRIO_AGING_US[TASK_PRIO_LEVELS] = {0, 20000, 200000};
+
+typedef struct PrioTask
+{
+    void (*function)(void *arg);
+    void *arg;
+    long long deadlineUs; // 有效截止时间
+    unsigned long seq;    // 入队序号，截止时间相同时先入队的先出
+} PrioTask;
+
+// 环形 FIFO，一个优先级一个
+typedef struct Level
+{
+    PrioTask *tasks;
+    int front;
+    int size;
+} Level;
+
+struct PrioQueue
+{
+    Level levels[TASK_PRIO_LEVELS];
+    PrioTask *heap; // 带截止时间的任务，按 deadlineUs 的小顶堆
+    int heapSize;
+    int capacity;
+    int size; // 所有级别的任务总数
+    unsigned long seq;
+};
+
+long long prioQueueNowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// a 是否应该排在 b 前面
+static int earlier(const PrioTask *a, const PrioTask *b)
+{
+    if (a->deadlineUs != b->deadlineUs)
+        return a->deadlineUs < b->deadlineUs;
+    return a->seq < b->seq;
+}
+
+PrioQueue *prioQueueCreate(int capacity)
+{
+    PrioQueue *q = (PrioQueue *)calloc(1, sizeof(PrioQueue));
+    if (q == NULL)
+    {
+        return NULL;
+    }
+    // 每一级都按总容量分配，任务怎么分布都放得下
+    for (int i = 0; i < TASK_PRIO_LEVELS; i++)
+    {
+        q->levels[i].tasks = (PrioTask *)malloc(sizeof(PrioTask) * capacity);
+        if (q->levels[i].tasks == NULL)
+        {
+            prioQueueDestroy(q);
+            return NULL;
+        }
+    }
+    q->heap = (PrioTask *)malloc(sizeof(PrioTask) * capacity);
+    if (q->heap == NULL)
+    {
+        prioQueueDestroy(q);
+        return NULL;
+    }
+    q->capacity = capacity;
+    return q;
+}
+
+void prioQueueDestroy(PrioQueue *q)
+{
+    if (q == NULL)
+        return;
+    for (int i = 0; i < TASK_PRIO_LEVELS; i++)
+    {
+        free(q->levels[i].tasks);
+    }
+    free(q->heap);
+    free(q);
+}
+
+static void heapPush(PrioQueue *q, PrioTask task)
+{
+    int i = q->heapSize++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!earlier(&task, &q->heap[parent]))
+            break;
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = task;
+}
+
+static PrioTask heapPop(PrioQueue *q)
+{
+    PrioTask top = q->heap[0];
+    PrioTask last = q->heap[--q->heapSize];
+    int i = 0;
+    while (1)
+    {
+        int child = 2 * i + 1;
+        if (child >= q->heapSize)
+            break;
+        if (child + 1 < q->heapSize && earlier(&q->heap[child + 1], &q->heap[child]))
+            child++;
+        if (!earlier(&q->heap[child], &last))
+            break;
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    q->heap[i] = last;
+    return top;
+}
+
+int prioQueuePush(PrioQueue *q, void (*func)(void *), void *arg, int priority, long long deadlineUs)
+{
+    if (q->size == q->capacity)
+    {
+        return 0;
+    }
+    if (priority < 0)
+        priority = 0;
+    if (priority >= TASK_PRIO_LEVELS)
+        priority = TASK_PRIO_LEVELS - 1;
+
+    PrioTask task;
+    task.function = func;
+    task.arg = arg;
+    task.seq = q->seq++;
+    if (deadlineUs > 0)
+    {
+        task.deadlineUs = deadlineUs;
+        heapPush(q, task);
+    }
+    else
+    {
+        // 同一级的老化时间相同，按入队顺序追加就是按有效截止时间有序
+        Level *level = &q->levels[priority];
+        task.deadlineUs = prioQueueNowUs() + PRIO_AGING_US[priority];
+        level->tasks[(level->front + level->size) % q->capacity] = task;
+        level->size++;
+    }
+    q->size++;
+    return 1;
+}
+
+int prioQueuePop(PrioQueue *q, void (**func)(void *), void **arg)
+{
+    if (q->size == 0)
+    {
+        return 0;
+    }
+    // 各级队头和堆顶中有效截止时间最早的那个
+    const PrioTask *best = q->heapSize > 0 ? &q->heap[0] : NULL;
+    int bestLevel = -1;
+    for (int i = 0; i < TASK_PRIO_LEVELS; i++)
+    {
+        Level *level = &q->levels[i];
+        if (level->size > 0 && (best == NULL || earlier(&level->tasks[level->front], best)))
+        {
+            best = &level->tasks[level->front];
+            bestLevel = i;
+        }
+    }
+
+    PrioTask task;
+    if (bestLevel < 0)
+    {
+        task = heapPop(q);
+    }
+    else
+    {
+        Level *level = &q->levels[bestLevel];
+        task = level->tasks[level->front];
+        level->front = (level->front + 1) % q->capacity;
+        level->size--;
+    }
+    q->size--;
+    *func = task.function;
+    *arg = task.arg;
+    return 1;
+}
+
+int prioQueueSize(PrioQueue *q)
+{
+    return q->size;
+}
@@ -0,0 +1,34 @@
+#ifndef _PRIOQUEUE_H
+#define _PRIOQUEUE_H
+
+// 多级优先级队列 + 截止时间(EDF)，本身不加锁，由线程池的 mutexPool 保护。
+// 每个优先级一个 FIFO，带截止时间的任务进小顶堆。出队时比较各级队头和堆顶的"有效截止时间"取最早的：
+//   带截止时间的任务就是它的截止时间；
+//   普通任务是 入队时间 + 该级的老化时间(PRIO_AGING_US)，
+// 所以低优先级任务等得足够久以后会排到新来的高优先级任务前面，不会饿死；同一级内仍然先进先出。
+typedef struct PrioQueue PrioQueue;
+
+// 优先级，数值越小越优先
+enum
+{
+    TASK_PRIO_HIGH = 0,
+    TASK_PRIO_NORMAL = 1,
+    TASK_PRIO_LOW = 2,
+    TASK_PRIO_LEVELS = 3,
+};
+
+// 创建队列，capacity 为所有级别合计的任务上限
+PrioQueue *prioQueueCreate(int capacity);
+void prioQueueDestroy(PrioQueue *q);
+
+// 入队，deadlineUs 为 CLOCK_MONOTONIC 下的绝对截止时间(微秒)，0 表示没有截止时间；满了返回 0
+int prioQueuePush(PrioQueue *q, void (*func)(void *), void *arg, int priority, long long deadlineUs);
+// 取出有效截止时间最早的任务，空了返回 0
+int prioQueuePop(PrioQueue *q, void (**func)(void *), void **arg);
+
+int prioQueueSize(PrioQueue *q);
+
+// CLOCK_MONOTONIC 当前时间(微秒)
+long long prioQueueNowUs();
+
+#endif // _PRIOQUEUE_H
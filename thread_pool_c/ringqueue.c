@@ -0,0 +1,265 @@
+#include "ringqueue.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// 满/空时先让出 CPU 重试这么多次再去 futex 上睡
+#define SPIN_ROUNDS 16
+
+// 环形队列的一个槽
+typedef struct Slot
+{
+    atomic_size_t seq;
+    void (*function)(void *arg);
+    void *arg;
+} Slot;
+
+struct RingQueue
+{
+    Slot *slots;
+    size_t mask; // 容量 - 1
+
+    // 生产者和消费者的位置放在不同的缓存行，避免互相干扰
+    _Alignas(64) atomic_size_t enqueuePos;
+    _Alignas(64) atomic_size_t dequeuePos;
+
+    // futex 字：每次需要唤醒时加 1，等待者拿旧值去 wait，值变了就不会睡下去
+    _Alignas(64) atomic_uint notEmpty;
+    atomic_uint notFull;
+    atomic_int emptyWaiters; // 在 notEmpty 上等待的消费者数
+    atomic_int fullWaiters;  // 在 notFull 上等待的生产者数
+    atomic_int kicks;        // 待处理的 ringQueueKick 次数
+    atomic_int closed;
+};
+
+static void futexWait(atomic_uint *addr, unsigned int val)
+{
+    syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void futexWake(atomic_uint *addr, int n)
+{
+    syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+// 有等待者才改 futex 字并进内核。
+// 调用前刚用 release 写了槽的 seq，release 写之后的读可以提前到写之前(store buffer)，
+// 所以先加一道 seq_cst fence，和等待方登记之后、复查之前的 fence 配对：两边至少有一方看到对方的写
+static void wakeIfWaiting(atomic_uint *futex, atomic_int *waiters, int n)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(waiters) > 0)
+    {
+        atomic_fetch_add(futex, 1);
+        futexWake(futex, n);
+    }
+}
+
+// 队头的槽已经写好了
+static int hasItem(RingQueue *q)
+{
+    size_t pos = atomic_load_explicit(&q->dequeuePos, memory_order_relaxed);
+    return atomic_load_explicit(&q->slots[pos & q->mask].seq, memory_order_acquire) == pos + 1;
+}
+
+// 队尾的槽已经空出来了
+static int hasSpace(RingQueue *q)
+{
+    size_t pos = atomic_load_explicit(&q->enqueuePos, memory_order_relaxed);
+    return atomic_load_explicit(&q->slots[pos & q->mask].seq, memory_order_acquire) == pos;
+}
+
+RingQueue *ringQueueCreate(int capacity)
+{
+    size_t cap = 2;
+    while (cap < (size_t)capacity)
+    {
+        cap <<= 1;
+    }
+    RingQueue *q = (RingQueue *)aligned_alloc(64, (sizeof(RingQueue) + 63) / 64 * 64);
+    if (q == NULL)
+    {
+        return NULL;
+    }
+    q->slots = (Slot *)malloc(sizeof(Slot) * cap);
+    if (q->slots == NULL)
+    {
+        free(q);
+        return NULL;
+    }
+    q->mask = cap - 1;
+    for (size_t i = 0; i < cap; i++)
+    {
+        atomic_init(&q->slots[i].seq, i);
+    }
+    atomic_init(&q->enqueuePos, 0);
+    atomic_init(&q->dequeuePos, 0);
+    atomic_init(&q->notEmpty, 0);
+    atomic_init(&q->notFull, 0);
+    atomic_init(&q->emptyWaiters, 0);
+    atomic_init(&q->fullWaiters, 0);
+    atomic_init(&q->kicks, 0);
+    atomic_init(&q->closed, 0);
+    return q;
+}
+
+void ringQueueDestroy(RingQueue *q)
+{
+    if (q == NULL)
+        return;
+    free(q->slots);
+    free(q);
+}
+
+int ringQueueTryPush(RingQueue *q, void (*func)(void *), void *arg)
+{
+    size_t pos = atomic_load_explicit(&q->enqueuePos, memory_order_relaxed);
+    Slot *slot;
+    while (1)
+    {
+        slot = &q->slots[pos & q->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0)
+        {
+            // 槽是空的，抢这个位置
+            if (atomic_compare_exchange_weak_explicit(&q->enqueuePos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (dif < 0)
+        {
+            return 0; // 满了：这个槽上一轮的任务还没被取走
+        }
+        else
+        {
+            pos = atomic_load_explicit(&q->enqueuePos, memory_order_relaxed); // 被别的生产者抢了
+        }
+    }
+    slot->function = func;
+    slot->arg = arg;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 1;
+}
+
+int ringQueueTryPop(RingQueue *q, void (**func)(void *), void **arg)
+{
+    size_t pos = atomic_load_explicit(&q->dequeuePos, memory_order_relaxed);
+    Slot *slot;
+    while (1)
+    {
+        slot = &q->slots[pos & q->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->dequeuePos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (dif < 0)
+        {
+            return 0; // 空的
+        }
+        else
+        {
+            pos = atomic_load_explicit(&q->dequeuePos, memory_order_relaxed);
+        }
+    }
+    *func = slot->function;
+    *arg = slot->arg;
+    // 序号推进一圈，这个槽留给下一轮的生产者
+    atomic_store_explicit(&slot->seq, pos + q->mask + 1, memory_order_release);
+    return 1;
+}
+
+int ringQueuePush(RingQueue *q, void (*func)(void *), void *arg)
+{
+    int spin = 0;
+    while (1)
+    {
+        if (atomic_load(&q->closed))
+            return -1;
+        if (ringQueueTryPush(q, func, arg))
+        {
+            wakeIfWaiting(&q->notEmpty, &q->emptyWaiters, 1);
+            return 0;
+        }
+        if (spin++ < SPIN_ROUNDS)
+        {
+            sched_yield();
+            continue;
+        }
+        // 先取 futex 值并登记，再检查一次，保证和消费者的唤醒不会错过
+        unsigned int val = atomic_load(&q->notFull);
+        atomic_fetch_add(&q->fullWaiters, 1);
+        atomic_thread_fence(memory_order_seq_cst); // 登记之后才复查槽位，见 wakeIfWaiting
+        if (!hasSpace(q) && !atomic_load(&q->closed))
+        {
+            futexWait(&q->notFull, val);
+        }
+        atomic_fetch_sub(&q->fullWaiters, 1);
+    }
+}
+
+int ringQueuePop(RingQueue *q, void (**func)(void *), void **arg)
+{
+    int spin = 0;
+    while (1)
+    {
+        if (atomic_load(&q->closed))
+            return -1;
+        if (ringQueueTryPop(q, func, arg))
+        {
+            wakeIfWaiting(&q->notFull, &q->fullWaiters, 1);
+            return 0;
+        }
+        int kicks = atomic_load(&q->kicks);
+        while (kicks > 0)
+        {
+            if (atomic_compare_exchange_weak(&q->kicks, &kicks, kicks - 1))
+                return 1;
+        }
+        if (spin++ < SPIN_ROUNDS)
+        {
+            sched_yield();
+            continue;
+        }
+        unsigned int val = atomic_load(&q->notEmpty);
+        atomic_fetch_add(&q->emptyWaiters, 1);
+        atomic_thread_fence(memory_order_seq_cst); // 登记之后才复查槽位，见 wakeIfWaiting
+        if (!hasItem(q) && !atomic_load(&q->closed) && atomic_load(&q->kicks) == 0)
+        {
+            futexWait(&q->notEmpty, val);
+        }
+        atomic_fetch_sub(&q->emptyWaiters, 1);
+    }
+}
+
+void ringQueueKick(RingQueue *q, int n)
+{
+    atomic_fetch_add(&q->kicks, n);
+    atomic_fetch_add(&q->notEmpty, 1);
+    futexWake(&q->notEmpty, n);
+}
+
+void ringQueueClose(RingQueue *q)
+{
+    atomic_store(&q->closed, 1);
+    atomic_fetch_add(&q->notEmpty, 1);
+    atomic_fetch_add(&q->notFull, 1);
+    futexWake(&q->notEmpty, INT_MAX);
+    futexWake(&q->notFull, INT_MAX);
+}
+
+int ringQueueSize(RingQueue *q)
+{
+    size_t enq = atomic_load_explicit(&q->enqueuePos, memory_order_relaxed);
+    size_t deq = atomic_load_explicit(&q->dequeuePos, memory_order_relaxed);
+    return enq > deq ? (int)(enq - deq) : 0;
+}
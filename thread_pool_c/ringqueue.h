@@ -0,0 +1,31 @@
+#ifndef _RINGQUEUE_H
+#define _RINGQUEUE_H
+
+// 无锁有界 MPMC 环形队列(Vyukov)，每个槽带一个序号：
+// 序号 == 位置 表示槽空可写，序号 == 位置 + 1 表示已写入可读，生产者和消费者各自 CAS 抢位置，不需要锁。
+// 只有队列满/空时才在 futex 上阻塞(之前先让出 CPU 重试几次)，平时入队出队都不进内核。
+typedef struct RingQueue RingQueue;
+
+// 创建队列，容量向上取整到 2 的幂
+RingQueue *ringQueueCreate(int capacity);
+// 销毁队列，调用前要保证没有线程还在使用
+void ringQueueDestroy(RingQueue *q);
+
+// 非阻塞入队/出队，成功返回 1，满/空返回 0
+int ringQueueTryPush(RingQueue *q, void (*func)(void *), void *arg);
+int ringQueueTryPop(RingQueue *q, void (**func)(void *), void **arg);
+
+// 阻塞入队，满了就等，成功返回 0，队列关闭返回 -1
+int ringQueuePush(RingQueue *q, void (*func)(void *), void *arg);
+// 阻塞出队，空了就等，取到任务返回 0，队列关闭返回 -1，被 ringQueueKick 叫醒返回 1
+int ringQueuePop(RingQueue *q, void (**func)(void *), void **arg);
+
+// 叫醒 n 个等待中的消费者(让它们从 ringQueuePop 返回 1)，管理者用来通知线程退出
+void ringQueueKick(RingQueue *q, int n);
+// 关闭队列并唤醒所有等待的线程
+void ringQueueClose(RingQueue *q);
+
+// 当前任务个数(近似值)
+int ringQueueSize(RingQueue *q);
+
+#endif // _RINGQUEUE_H
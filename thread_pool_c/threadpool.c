@@ -1,4 +1,6 @@
 #include "threadpool.h"
+#include "ringqueue.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -22,6 +24,8 @@ struct ThreadPool
     int queueSize;     // 当前任务个数
     int queueFront;    // 队头 -> 取数据
     int queueRear;     // 队尾 -> 放数据
+    RingQueue *ring;   // 无锁模式下的任务队列，此时上面的 taskQ 不用，为 NULL
+    PrioQueue *prio;   // 优先级模式下的任务队列，此时 taskQ 不用，为 NULL；queueSize 照常维护
 
     pthread_t managerID;       // 管理者线程ID
     pthread_t *threadIDs;      // 工作的线程ID
@@ -34,13 +38,28 @@ struct ThreadPool
     pthread_mutex_t mutexBusy; // 锁busyNum变量，因为busyNum需要经常修改
     pthread_cond_t notFull;    // 任务队列是不是满了
     pthread_cond_t notEmpty;   // 任务队列是不是空了
+    atomic_int busyAtomic;     // 无锁模式下的忙线程数，不用 mutexBusy
 
     int shutdown; // 是不是要销毁线程池, 销毁为1, 不销毁为0
 };
 
+static void *workerLockFree(void *arg);
+
 ThreadPool *threadPoolCreate(int min, int max, int queueCapacity)
+{
+    return threadPoolCreateEx(min, max, queueCapacity, QUEUE_MUTEX);
+}
+
+ThreadPool *threadPoolCreateEx(int min, int max, int queueCapacity, int queueType)
 {
     ThreadPool *pool = (ThreadPool *)malloc(sizeof(ThreadPool));
+    if (pool)
+    {
+        pool->threadIDs = NULL;
+        pool->taskQ = NULL;
+        pool->ring = NULL;
+        pool->prio = NULL;
+    }
     do
     {
         // 创建整个池
@@ -64,6 +83,7 @@ ThreadPool *threadPoolCreate(int min, int max, int queueCapacity)
         pool->busyNum = 0;
         pool->exitNum = 0;
         pool->shutdown = 0;
+        atomic_init(&pool->busyAtomic, 0);
 
         if (pthread_mutex_init(&pool->mutexPool, NULL) != 0 ||
             pthread_mutex_init(&pool->mutexBusy, NULL) != 0 ||
@@ -75,7 +95,28 @@ ThreadPool *threadPoolCreate(int min, int max, int queueCapacity)
         }
 
         // 创建任务队列及其属性
-        pool->taskQ = (Task *)malloc(sizeof(Task) * queueCapacity);
+        if (queueType == QUEUE_LOCKFREE)
+        {
+            pool->ring = ringQueueCreate(queueCapacity);
+            if (pool->ring == NULL)
+            {
+                printf("create ring queue failed....");
+                break;
+            }
+        }
+        else if (queueType == QUEUE_PRIORITY)
+        {
+            pool->prio = prioQueueCreate(queueCapacity);
+            if (pool->prio == NULL)
+            {
+                printf("create priority queue failed....");
+                break;
+            }
+        }
+        else
+        {
+            pool->taskQ = (Task *)malloc(sizeof(Task) * queueCapacity);
+        }
         pool->queueCapacity = queueCapacity;
         pool->queueSize = 0;
         pool->queueFront = 0;
@@ -85,7 +126,7 @@ ThreadPool *threadPoolCreate(int min, int max, int queueCapacity)
         pthread_create(&pool->managerID, NULL, manager, pool); // 管理者线程
         for (int i = 0; i < min; ++i)                          // N个工作者线程，按照最小数创建(实质上应该按照liveNum创建)
         {
-            pthread_create(&pool->threadIDs[i], NULL, worker, pool);
+            pthread_create(&pool->threadIDs[i], NULL, pool->ring ? workerLockFree : worker, pool);
         }
         return pool;
     } while (0);
@@ -97,6 +138,10 @@ ThreadPool *threadPoolCreate(int min, int max, int queueCapacity)
         free(pool->threadIDs);
     if (pool && pool->taskQ)
         free(pool->taskQ);
+    if (pool && pool->ring)
+        ringQueueDestroy(pool->ring);
+    if (pool && pool->prio)
+        prioQueueDestroy(pool->prio);
     if (pool)
         free(pool);
     return NULL;
@@ -111,6 +156,10 @@ int threadPoolDestroy(ThreadPool *pool)
     // 管理线程的while循环退出
     pthread_join(pool->managerID, NULL);
     // 唤醒全部工作者线程
+    if (pool->ring)
+    {
+        ringQueueClose(pool->ring);
+    }
     for (int i = 0; i < pool->liveNum; i++)
     {
         pthread_cond_signal(&pool->notEmpty);
@@ -125,6 +174,16 @@ int threadPoolDestroy(ThreadPool *pool)
         free(pool->taskQ);
         pool->taskQ = NULL;
     }
+    if (pool->ring)
+    {
+        ringQueueDestroy(pool->ring);
+        pool->ring = NULL;
+    }
+    if (pool->prio)
+    {
+        prioQueueDestroy(pool->prio);
+        pool->prio = NULL;
+    }
     if (pool->threadIDs)
     {
         free(pool->threadIDs);
@@ -144,6 +203,17 @@ int threadPoolDestroy(ThreadPool *pool)
 
 void threadPoolAdd(ThreadPool *pool, void (*func)(void *), void *arg)
 {
+    threadPoolAddEx(pool, func, arg, TASK_PRIO_NORMAL, 0);
+}
+
+void threadPoolAddEx(ThreadPool *pool, void (*func)(void *), void *arg, int priority, int deadlineMs)
+{
+    if (pool->ring)
+    {
+        // 无锁队列自己处理满了阻塞和唤醒消费者
+        ringQueuePush(pool->ring, func, arg);
+        return;
+    }
     pthread_mutex_lock(&pool->mutexPool);
     // 任务队列已经满了，那就得阻塞，直到notFull为真。
     while (pool->queueSize == pool->queueCapacity && !pool->shutdown)
@@ -157,9 +227,17 @@ void threadPoolAdd(ThreadPool *pool, void (*func)(void *), void *arg)
         return;
     }
     // 添加任务
-    pool->taskQ[pool->queueRear].function = func;
-    pool->taskQ[pool->queueRear].arg = arg;
-    pool->queueRear = (pool->queueRear + 1) % pool->queueCapacity;
+    if (pool->prio)
+    {
+        long long deadlineUs = deadlineMs > 0 ? prioQueueNowUs() + deadlineMs * 1000LL : 0;
+        prioQueuePush(pool->prio, func, arg, priority, deadlineUs);
+    }
+    else
+    {
+        pool->taskQ[pool->queueRear].function = func;
+        pool->taskQ[pool->queueRear].arg = arg;
+        pool->queueRear = (pool->queueRear + 1) % pool->queueCapacity;
+    }
     pool->queueSize++;
 
     // 唤醒消费者
@@ -169,6 +247,10 @@ void threadPoolAdd(ThreadPool *pool, void (*func)(void *), void *arg)
 
 int threadPoolBusyNum(ThreadPool *pool)
 {
+    if (pool->ring)
+    {
+        return atomic_load_explicit(&pool->busyAtomic, memory_order_relaxed);
+    }
     pthread_mutex_lock(&pool->mutexBusy);
     int busyNum = pool->busyNum;
     pthread_mutex_unlock(&pool->mutexBusy);
@@ -221,11 +303,19 @@ void *worker(void *arg)
 
         // 唤醒之后开始工作,首先找到最前面的任务
         Task task;
-        task.function = pool->taskQ[pool->queueFront].function;
-        task.arg = pool->taskQ[pool->queueFront].arg;
+        if (pool->prio)
+        {
+            // 优先级队列：取有效截止时间最早的任务
+            prioQueuePop(pool->prio, &task.function, &task.arg);
+        }
+        else
+        {
+            task.function = pool->taskQ[pool->queueFront].function;
+            task.arg = pool->taskQ[pool->queueFront].arg;
 
-        // 维护环形队列
-        pool->queueFront = (pool->queueFront + 1) % pool->queueCapacity;
+            // 维护环形队列
+            pool->queueFront = (pool->queueFront + 1) % pool->queueCapacity;
+        }
         pool->queueSize--;
 
         // 唤醒生产者，然后解锁
@@ -234,7 +324,9 @@ void *worker(void *arg)
 
         // 之前从线程池中获取了任务，现在开始执行任务。
         // 忙任务 + 1
+#if THREADPOOL_VERBOSE
         printf("thread %ld start working...\n", pthread_self());
+#endif
         pthread_mutex_lock(&pool->mutexBusy);
         pool->busyNum++;
         pthread_mutex_unlock(&pool->mutexBusy);
@@ -243,7 +335,9 @@ void *worker(void *arg)
         free(task.arg);
         task.arg = NULL;
         // 忙任务-1
+#if THREADPOOL_VERBOSE
         printf("thread %ld end working...\n", pthread_self());
+#endif
         pthread_mutex_lock(&pool->mutexBusy);
         pool->busyNum--;
         pthread_mutex_unlock(&pool->mutexBusy);
@@ -251,6 +345,47 @@ void *worker(void *arg)
     return NULL;
 }
 
+// 无锁队列的工作线程：取任务不加锁，忙线程数用原子变量，只有退出时才碰 mutexPool
+static void *workerLockFree(void *arg)
+{
+    ThreadPool *pool = (ThreadPool *)arg;
+
+    while (1)
+    {
+        void (*function)(void *);
+        void *taskArg;
+        int ret = ringQueuePop(pool->ring, &function, &taskArg);
+        if (ret < 0)
+        {
+            // 线程池被关闭了
+            threadExit(pool);
+        }
+        if (ret > 0)
+        {
+            // 被管理者叫醒，看看是不是要自杀
+            pthread_mutex_lock(&pool->mutexPool);
+            if (pool->exitNum > 0)
+            {
+                pool->exitNum--;
+                if (pool->liveNum > pool->minNum)
+                {
+                    pool->liveNum--;
+                    pthread_mutex_unlock(&pool->mutexPool);
+                    threadExit(pool);
+                }
+            }
+            pthread_mutex_unlock(&pool->mutexPool);
+            continue;
+        }
+
+        atomic_fetch_add_explicit(&pool->busyAtomic, 1, memory_order_relaxed);
+        function(taskArg);
+        free(taskArg);
+        atomic_fetch_sub_explicit(&pool->busyAtomic, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
 void *manager(void *arg)
 {
 
@@ -262,13 +397,11 @@ void *manager(void *arg)
 
         // 取出线程数量和任务数量进行比较
         pthread_mutex_lock(&pool->mutexPool);
-        int queueSize = pool->queueSize; // 任务个数
+        int queueSize = pool->ring ? ringQueueSize(pool->ring) : pool->queueSize; // 任务个数
         int liveNum = pool->liveNum;     // 线程个数
         pthread_mutex_unlock(&pool->mutexPool);
 
-        pthread_mutex_lock(&pool->mutexBusy);
-        int busyNum = pool->busyNum;
-        pthread_mutex_unlock(&pool->mutexBusy);
+        int busyNum = threadPoolBusyNum(pool);
 
         // 添加线程
         // 当前任务个数 > 线程数量 且 线程数量比最大数量小
@@ -280,12 +413,14 @@ void *manager(void *arg)
             {
                 if (pool->threadIDs[i] == 0)
                 {
-                    pthread_create(&pool->threadIDs[i], NULL, worker, pool);
+                    pthread_create(&pool->threadIDs[i], NULL, pool->ring ? workerLockFree : worker, pool);
                     pool->liveNum++;
                     cnt++;
                 }
             }
+#if THREADPOOL_VERBOSE
             printf("add %d thread success\n",cnt);
+#endif
             pthread_mutex_unlock(&pool->mutexPool);
         }
 
@@ -297,6 +432,10 @@ void *manager(void *arg)
             pool->exitNum = NUM;
             pthread_mutex_unlock(&pool->mutexPool);
             // 通知工作的线程自杀
+            if (pool->ring)
+            {
+                ringQueueKick(pool->ring, NUM);
+            }
             for (int i = 0; i < NUM; i++)
             {
                 pthread_cond_signal(&pool->notEmpty);
@@ -317,7 +456,9 @@ void threadExit(ThreadPool *pool)
         if (pool->threadIDs[i] == tid)
         {
             pool->threadIDs[i] = 0;
+#if THREADPOOL_VERBOSE
             printf("threadExit() called, %ld exiting...\n", tid);
+#endif
             break;
         }
     }
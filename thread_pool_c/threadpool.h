@@ -1,15 +1,35 @@
 #ifndef _THREADPOOL_H
 #define _THREADPOOL_H
 
+#include "prioqueue.h"
+
 typedef struct ThreadPool ThreadPool;
 
+// 工作线程打印日志，压测时定义为 0 关掉
+#ifndef THREADPOOL_VERBOSE
+#define THREADPOOL_VERBOSE 1
+#endif
+
+// 任务队列的实现
+enum
+{
+    QUEUE_MUTEX = 0,    // 互斥锁 + notFull/notEmpty 条件变量的环形队列
+    QUEUE_LOCKFREE = 1, // 无锁 MPMC 环形队列，只在满/空时用 futex 阻塞
+    QUEUE_PRIORITY = 2, // 互斥锁保护的多级优先级 + 截止时间队列(见 prioqueue.h)，其余同 QUEUE_MUTEX
+};
+
 // 创建线程池并初始化
 ThreadPool *threadPoolCreate(int min, int max, int queueCapacity);
+// 创建线程池并指定任务队列的实现
+ThreadPool *threadPoolCreateEx(int min, int max, int queueCapacity, int queueType);
 // 销毁线程池
 int threadPoolDestroy(ThreadPool* pool);
 
 // 给线程池添加任务
 void threadPoolAdd(ThreadPool* pool, void(*func)(void*), void* arg);
+// 添加带优先级(TASK_PRIO_*)和截止时间的任务，deadlineMs 为从现在起的毫秒数，0 表示没有截止时间；
+// 只有 QUEUE_PRIORITY 队列按优先级和截止时间调度，其他队列忽略这两个参数、按先进先出执行
+void threadPoolAddEx(ThreadPool* pool, void(*func)(void*), void* arg, int priority, int deadlineMs);
 
 // 获取线程池中工作的线程的个数
 int threadPoolBusyNum(ThreadPool* pool);
@@ -1,8 +1,19 @@
 #ifndef __TASKQUEUE__
 #define __TASKQUEUE__
 
+#include <chrono>
 #include <pthread.h>
 #include <queue>
+#include <vector>
+
+// 任务优先级，数值越小越优先
+enum TaskPriority
+{
+    PRIORITY_HIGH = 0,
+    PRIORITY_NORMAL = 1,
+    PRIORITY_LOW = 2,
+    PRIORITY_LEVELS = 3,
+};
 
 using callback = void (*)(void *);
 template <typename T>
@@ -10,20 +21,72 @@ struct Task
 {
     callback function;
     T *arg;
+    TaskPriority priority;
+    std::chrono::steady_clock::time_point deadline;    // 截止时间，time_point::max() 表示没有
+    std::chrono::steady_clock::time_point enqueueTime; // 入队时间，用来统计排队延迟
+    std::chrono::steady_clock::time_point dueTime;     // 有效截止时间，入队时由任务队列计算
+    unsigned long seq;                                 // 入队序号，有效截止时间相同时先入队的先出
 
-    Task() : function(nullptr), arg(nullptr) {}
-    Task(callback func, void *arg) : function(func), arg((T *)arg) {}
+    Task() : function(nullptr), arg(nullptr), priority(PRIORITY_NORMAL), deadline(std::chrono::steady_clock::time_point::max()), seq(0) {}
+    // deadlineMs > 0 时任务带截止时间(从现在起的毫秒数)，按截止时间最早优先调度
+    Task(callback func, void *arg, TaskPriority priority = PRIORITY_NORMAL, int deadlineMs = 0)
+        : function(func), arg((T *)arg), priority(priority), deadline(std::chrono::steady_clock::time_point::max()), seq(0)
+    {
+        if (deadlineMs > 0)
+        {
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs);
+        }
+    }
 };
 
+// 多级优先级 + 截止时间的任务队列：每个优先级一个 FIFO，带截止时间的任务进小顶堆，
+// 取任务时比较各级队头和堆顶的有效截止时间，取最早的。
+// 有效截止时间：带截止时间的任务就是截止时间，普通任务是 入队时间 + 该级的老化时间，
+// 低优先级任务等得足够久就会排到新来的高优先级任务前面，不会饿死
 template <typename T>
 class TaskQueue
 {
 private:
-    std::queue<Task<T>> m_queue;
+    // 比较堆里的任务，有效截止时间晚的排在后面
+    struct Later
+    {
+        bool operator()(const Task<T> &a, const Task<T> &b) const
+        {
+            return a.dueTime != b.dueTime ? a.dueTime > b.dueTime : a.seq > b.seq;
+        }
+    };
+
+    static std::chrono::microseconds agingTime(TaskPriority priority)
+    {
+        static const std::chrono::microseconds AGING[PRIORITY_LEVELS] = {
+            std::chrono::microseconds(0), std::chrono::microseconds(20000), std::chrono::microseconds(200000)};
+        return AGING[priority];
+    }
+
+    // 有效截止时间最早的任务所在的位置，-1 表示堆顶，调用时持有锁且队列非空
+    int nextLevel()
+    {
+        const Task<T> *best = m_deadlines.empty() ? nullptr : &m_deadlines.top();
+        int level = -1;
+        for (int i = 0; i < PRIORITY_LEVELS; i++)
+        {
+            if (!m_levels[i].empty() && (best == nullptr || Later()(*best, m_levels[i].front())))
+            {
+                best = &m_levels[i].front();
+                level = i;
+            }
+        }
+        return level;
+    }
+
+    std::queue<Task<T>> m_levels[PRIORITY_LEVELS];
+    std::priority_queue<Task<T>, std::vector<Task<T>>, Later> m_deadlines;
+    size_t m_size;
+    unsigned long m_seq;
     pthread_mutex_t m_mutex; // 互斥锁
 
 public:
-    TaskQueue(/* args */)
+    TaskQueue(/* args */) : m_size(0), m_seq(0)
     {
         pthread_mutex_init(&m_mutex, NULL);
     };
@@ -34,29 +97,36 @@ public:
 
     void addTask(Task<T> &task)
     {
+        task.enqueueTime = std::chrono::steady_clock::now();
         pthread_mutex_lock(&m_mutex);
-        m_queue.push(task);
+        push(task);
         pthread_mutex_unlock(&m_mutex);
     };
 
     void addTask(callback func, void *arg)
     {
-        pthread_mutex_lock(&m_mutex);
-        Task<T> task;
-        task.function = func;
-        task.arg = arg;
-        m_queue.push(task);
-        pthread_mutex_unlock(&m_mutex);
+        Task<T> task(func, arg);
+        addTask(task);
     };
 
     Task<T> takeTask()
     {
         Task<T> task;
         pthread_mutex_lock(&m_mutex);
-        if (!m_queue.empty())
+        if (m_size > 0)
         {
-            task = m_queue.front();
-            m_queue.pop();
+            int level = nextLevel();
+            if (level < 0)
+            {
+                task = m_deadlines.top();
+                m_deadlines.pop();
+            }
+            else
+            {
+                task = m_levels[level].front();
+                m_levels[level].pop();
+            }
+            m_size--;
         }
         pthread_mutex_unlock(&m_mutex);
         return task;
@@ -64,7 +134,41 @@ public:
 
     inline size_t taskNumber()
     {
-        return m_queue.size();
+        return m_size;
+    }
+
+    // 下一个要取出的任务已经等待的时间，队列为空时返回 0
+    std::chrono::nanoseconds headWaitTime()
+    {
+        std::chrono::nanoseconds wait(0);
+        pthread_mutex_lock(&m_mutex);
+        if (m_size > 0)
+        {
+            int level = nextLevel();
+            const Task<T> &next = level < 0 ? m_deadlines.top() : m_levels[level].front();
+            wait = std::chrono::steady_clock::now() - next.enqueueTime;
+        }
+        pthread_mutex_unlock(&m_mutex);
+        return wait;
+    }
+
+private:
+    // 计算有效截止时间并放进对应的队列，调用时持有锁
+    void push(Task<T> &task)
+    {
+        task.seq = m_seq++;
+        if (task.deadline != std::chrono::steady_clock::time_point::max())
+        {
+            task.dueTime = task.deadline;
+            m_deadlines.push(task);
+        }
+        else
+        {
+            // 同一级的老化时间相同，按入队顺序追加就是按有效截止时间有序
+            task.dueTime = task.enqueueTime + agingTime(task.priority);
+            m_levels[task.priority].push(task);
+        }
+        m_size++;
     }
 };
 
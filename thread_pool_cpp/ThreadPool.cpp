@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string.h>
 #include <string>
@@ -6,7 +8,7 @@
 using namespace std;
 
 template <typename T>
-ThreadPool<T>::ThreadPool(int minNum, int maxNum)
+ThreadPool<T>::ThreadPool(int minNum, int maxNum, bool adaptive)
 {
     do
     {
@@ -18,6 +20,13 @@ ThreadPool<T>::ThreadPool(int minNum, int maxNum)
         m_maxNum = maxNum;
         m_busyNum = 0;
         m_aliveNum = minNum;
+        m_exitNum = 0;
+        m_parkNum = 0;
+        m_parkedNum = 0;
+        m_unparkNum = 0;
+        m_delayNs = 0;
+        m_delayCnt = 0;
+        m_adaptive = adaptive;
         m_shutdown = false;
 
         // 线程池ID列表
@@ -31,7 +40,8 @@ ThreadPool<T>::ThreadPool(int minNum, int maxNum)
         memset(m_threadIDs, 0, sizeof(pthread_t) * maxNum);
         // 初始化互斥锁,条件变量
         if (pthread_mutex_init(&m_lock, NULL) != 0 ||
-            pthread_cond_init(&m_notEmpty, NULL) != 0)
+            pthread_cond_init(&m_notEmpty, NULL) != 0 ||
+            pthread_cond_init(&m_parkCond, NULL) != 0)
         {
             cout << "init mutex or condition fail..." << endl;
             break;
@@ -41,7 +51,9 @@ ThreadPool<T>::ThreadPool(int minNum, int maxNum)
         for (int i = 0; i < minNum; ++i)
         {
             pthread_create(&m_threadIDs[i], NULL, worker, this);
+#if THREADPOOL_VERBOSE
             cout << "创建子线程, ID: " << to_string(m_threadIDs[i]) << endl;
+#endif
         }
         // 创建管理者线程, 1个
         pthread_create(&m_managerID, NULL, manager, this);
@@ -66,6 +78,9 @@ ThreadPool<T>::~ThreadPool()
     //     pthread_cond_signal(&m_notEmpty);
     // } // 逐个唤醒
     pthread_cond_broadcast(&m_notEmpty); // 全部唤醒
+    pthread_mutex_lock(&m_lock);
+    pthread_mutex_unlock(&m_lock);
+    pthread_cond_broadcast(&m_parkCond); // 挂起的线程也要唤醒退出
     for (int i = 0; i < m_maxNum; ++i)
     {
         if (m_threadIDs[i] != 0)
@@ -77,6 +92,7 @@ ThreadPool<T>::~ThreadPool()
         delete[] m_threadIDs;
     pthread_mutex_destroy(&m_lock);
     pthread_cond_destroy(&m_notEmpty);
+    pthread_cond_destroy(&m_parkCond);
 }
 
 template <typename T>
@@ -93,14 +109,14 @@ void ThreadPool<T>::addTask(Task<T> task)
 }
 
 template <typename T>
-void ThreadPool<T>::addTask(callback fun, void *arg)
+void ThreadPool<T>::addTask(callback fun, void *arg, TaskPriority priority, int deadlineMs)
 {
     if (m_shutdown)
     {
         return;
     }
     // 添加任务，不需要加锁，任务队列中有锁
-    Task<T> task(fun, arg);
+    Task<T> task(fun, arg, priority, deadlineMs);
     m_taskQ->addTask(task);
     // 唤醒工作的线程
     pthread_cond_signal(&m_notEmpty);
@@ -116,6 +132,16 @@ int ThreadPool<T>::getAliveNumber()
     return threadNum;
 }
 
+template <typename T>
+int ThreadPool<T>::getParkedNumber()
+{
+    int parkedNum = 0;
+    pthread_mutex_lock(&m_lock);
+    parkedNum = m_parkedNum;
+    pthread_mutex_unlock(&m_lock);
+    return parkedNum;
+}
+
 template <typename T>
 int ThreadPool<T>::getBusyNumber()
 {
@@ -139,10 +165,29 @@ void *ThreadPool<T>::worker(void *arg)
         // 判断任务队列是否为空, 如果为空工作线程阻塞
         while (pool->m_taskQ->taskNumber() == 0 && !pool->m_shutdown)
         {
+#if THREADPOOL_VERBOSE
             cout << "thread " << to_string(pthread_self()) << " waiting..." << endl;
+#endif
             // 阻塞线程
             pthread_cond_wait(&pool->m_notEmpty, &pool->m_lock);
 
+            // 自适应模式缩容：挂起而不是退出，扩容时直接唤醒；
+            // 醒来时队列里已经有任务了就说明负载又上来了，剩下的缩容作废，先去干活
+            if (pool->m_parkNum > 0 && pool->m_taskQ->taskNumber() > 0)
+            {
+                pool->m_parkNum = 0;
+                continue;
+            }
+            if (pool->m_parkNum > 0)
+            {
+                pool->m_parkNum--;
+                if (pool->m_aliveNum > pool->m_minNum)
+                {
+                    pool->park();
+                }
+                continue;
+            }
+
             // 解除阻塞之后, 判断是否要销毁线程
             if (pool->m_exitNum > 0)
             {
@@ -159,8 +204,10 @@ void *ThreadPool<T>::worker(void *arg)
                             break;
                         }
                     }
+#if THREADPOOL_VERBOSE
                     cout << "threadExit() function: thread "
                          << to_string(pthread_self()) << " exiting..." << endl;
+#endif
                     pthread_mutex_unlock(&pool->m_lock);
                     pool->threadExit();
                 }
@@ -169,8 +216,10 @@ void *ThreadPool<T>::worker(void *arg)
         // 判断线程池是否被关闭了
         if (pool->m_shutdown)
         {
+#if THREADPOOL_VERBOSE
             cout << "threadExit() function: thread "
                  << to_string(pthread_self()) << " exiting..." << endl;
+#endif
             pthread_mutex_unlock(&pool->m_lock);
             pool->threadExit();
         }
@@ -179,9 +228,14 @@ void *ThreadPool<T>::worker(void *arg)
         Task<T> task = pool->m_taskQ->takeTask();
         // 工作的线程+1
         pool->m_busyNum++;
+        // 累计排队延迟，供管理者线程计算
+        pool->m_delayNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - task.enqueueTime).count();
+        pool->m_delayCnt++;
 
+#if THREADPOOL_VERBOSE
         // 执行任务log，,放在锁里面避免打印混乱
         cout << "thread " << to_string(pthread_self()) << " start working..." << endl;
+#endif
         // 线程池解锁，然后执行任务
         pthread_mutex_unlock(&pool->m_lock);
         task.function(task.arg);
@@ -189,8 +243,10 @@ void *ThreadPool<T>::worker(void *arg)
         task.arg = nullptr;
 
         pthread_mutex_lock(&pool->m_lock);
+#if THREADPOOL_VERBOSE
         // 任务处理结束log,放在锁里面避免打印混乱
         cout << "thread " << to_string(pthread_self()) << " end working..." << endl;
+#endif
         pool->m_busyNum--;
         pthread_mutex_unlock(&pool->m_lock);
     }
@@ -201,6 +257,21 @@ template <typename T>
 void *ThreadPool<T>::manager(void *arg)
 {
     ThreadPool<T> *pool = static_cast<ThreadPool<T> *>(arg);
+    if (pool->m_adaptive)
+    {
+        pool->manageAdaptive();
+    }
+    else
+    {
+        pool->manageLegacy();
+    }
+    return nullptr;
+}
+
+template <typename T>
+void ThreadPool<T>::manageLegacy()
+{
+    ThreadPool<T> *pool = this;
     // 如果线程池没有关闭, 就一直检测
     while (!pool->m_shutdown)
     {
@@ -230,7 +301,9 @@ void *ThreadPool<T>::manager(void *arg)
                     pool->m_aliveNum++;
                 }
             }
+#if THREADPOOL_VERBOSE
             cout << "Creating " << cnt << " Thread Success ! Alive Thread = " << pool->m_aliveNum << endl;
+#endif
             pthread_mutex_unlock(&pool->m_lock);
         }
 
@@ -247,7 +320,102 @@ void *ThreadPool<T>::manager(void *arg)
             }
         }
     }
-    return nullptr;
+}
+
+template <typename T>
+void ThreadPool<T>::manageAdaptive()
+{
+    double busyAvg = 0; // 忙碌比例的指数移动平均
+    while (!m_shutdown)
+    {
+        usleep(MANAGE_INTERVAL_MS * 1000);
+
+        pthread_mutex_lock(&m_lock);
+        int queueSize = m_taskQ->taskNumber();
+        int liveNum = m_aliveNum;
+        int busyNum = m_busyNum;
+        double avgDelayUs = m_delayCnt > 0 ? m_delayNs / 1000.0 / m_delayCnt : 0;
+        m_delayNs = 0;
+        m_delayCnt = 0;
+        if (queueSize > 0)
+        {
+            m_parkNum = 0; // 上一周期没找到空闲线程执行的缩容不再有效
+        }
+        pthread_mutex_unlock(&m_lock);
+
+        // 还在队列里的任务也算上，否则全部线程都卡住时本周期一个样本都没有
+        double headWaitUs = chrono::duration_cast<chrono::microseconds>(m_taskQ->headWaitTime()).count();
+        double delayUs = max(avgDelayUs, headWaitUs);
+        busyAvg = 0.5 * busyAvg + 0.5 * (liveNum > 0 ? static_cast<double>(busyNum) / liveNum : 1.0);
+
+        if (queueSize > 0 && delayUs > TARGET_DELAY_US)
+        {
+            // 延迟超出目标越多扩得越多，至少 1 个，最多不超过积压的任务数
+            int grow = static_cast<int>(ceil(liveNum * (delayUs / TARGET_DELAY_US - 1)));
+            grow = max(1, min(grow, queueSize));
+            pthread_mutex_lock(&m_lock);
+            growLocked(grow);
+            pthread_mutex_unlock(&m_lock);
+        }
+        else if (queueSize == 0 && delayUs < TARGET_DELAY_US / 4 && liveNum > m_minNum)
+        {
+            // 按平均忙碌比例算出需要的线程数，一次最多收掉多出来的一半，避免抖动
+            int want = max(m_minNum, static_cast<int>(ceil(busyAvg * liveNum / TARGET_BUSY)));
+            int shrink = (liveNum - want + 1) / 2;
+            if (shrink > 0)
+            {
+                pthread_mutex_lock(&m_lock);
+                m_parkNum = shrink;
+                pthread_mutex_unlock(&m_lock);
+                for (int i = 0; i < shrink; ++i)
+                {
+                    pthread_cond_signal(&m_notEmpty);
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+int ThreadPool<T>::growLocked(int n)
+{
+    m_parkNum = 0; // 扩容时取消还没执行的缩容
+    n = min(n, m_maxNum - m_aliveNum);
+    // 先唤醒挂起的线程，它们醒来后直接回到工作循环
+    int wake = min(n, m_parkedNum);
+    m_unparkNum += wake;
+    m_parkedNum -= wake;
+    m_aliveNum += wake;
+    for (int i = 0; i < wake; ++i)
+    {
+        pthread_cond_signal(&m_parkCond);
+    }
+    int cnt = wake;
+    for (int i = 0; i < m_maxNum && cnt < n; ++i)
+    {
+        if (m_threadIDs[i] == 0)
+        {
+            pthread_create(&m_threadIDs[i], NULL, worker, this);
+            cnt++;
+            m_aliveNum++;
+        }
+    }
+    return cnt;
+}
+
+template <typename T>
+void ThreadPool<T>::park()
+{
+    m_aliveNum--;
+    m_parkedNum++;
+    while (m_unparkNum == 0 && !m_shutdown)
+    {
+        pthread_cond_wait(&m_parkCond, &m_lock);
+    }
+    if (m_unparkNum > 0)
+    {
+        m_unparkNum--; // 计数已由 growLocked 调整好
+    }
 }
 
 // 这里对比大丙那作了删改，先放着吧
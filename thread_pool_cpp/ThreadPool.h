@@ -3,31 +3,53 @@
 
 #include "TaskQueue.hpp"
 
+// 工作线程打印日志，压测时定义为 0 关掉
+#ifndef THREADPOOL_VERBOSE
+#define THREADPOOL_VERBOSE 1
+#endif
+
 template <typename T> 
 class ThreadPool
 {
 public:
-    ThreadPool(int minNum, int maxNum);
+    // adaptive 为 true 时管理者每 MANAGE_INTERVAL_MS 采样一次排队延迟和忙碌比例，按比例扩缩容，
+    // 缩容的线程先挂起，扩容时优先唤醒挂起的线程，不够才 pthread_create；
+    // 为 false(默认)时是原来的做法：每 3s 检查一次，按队列长度和存活线程数一次增减 2 个
+    ThreadPool(int minNum, int maxNum, bool adaptive = false);
     ~ThreadPool();
 
     // 添加任务
     void addTask(Task<T> task);
-    void addTask(callback fun, void* arg);
+    // 优先级和截止时间见 TaskQueue.hpp，deadlineMs 为 0 表示没有截止时间
+    void addTask(callback fun, void* arg, TaskPriority priority = PRIORITY_NORMAL, int deadlineMs = 0);
     // 获取忙线程的个数
     int getBusyNumber();
     // 获取活着的线程个数
     int getAliveNumber();
+    // 获取挂起的线程个数
+    int getParkedNumber();
 
 private:
     // 工作的线程的任务函数
     static void* worker(void* arg);
     // 管理者线程的任务函数
     static void* manager(void* arg);
+    void manageLegacy();
+    void manageAdaptive();
+    // 扩容 n 个线程，优先唤醒挂起的线程，调用时持有 m_lock
+    int growLocked(int n);
+    // 在 m_parkCond 上挂起，直到被唤醒或线程池关闭，调用时持有 m_lock
+    void park();
     void threadExit();
 
+    static const int MANAGE_INTERVAL_MS = 100; // 自适应模式的采样周期
+    static const int TARGET_DELAY_US = 2000;   // 期望的排队延迟上限
+    static constexpr double TARGET_BUSY = 0.75; // 缩容时期望的忙碌比例
+
 private:
     pthread_mutex_t m_lock;
     pthread_cond_t m_notEmpty;
+    pthread_cond_t m_parkCond;
     pthread_t* m_threadIDs;
     pthread_t m_managerID;
     TaskQueue<T>* m_taskQ;
@@ -36,6 +58,12 @@ private:
     int m_busyNum;
     int m_aliveNum;
     int m_exitNum;
+    int m_parkNum;   // 待挂起的线程数，队列里有任务或扩容时清零
+    int m_parkedNum; // 已挂起的线程数
+    int m_unparkNum; // 待唤醒的挂起线程数
+    long long m_delayNs; // 本周期内取出的任务的排队时间之和
+    long m_delayCnt;     // 本周期内取出的任务数
+    bool m_adaptive;
     bool m_shutdown = false;
 };
 
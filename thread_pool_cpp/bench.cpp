@@ -0,0 +1,70 @@
+// 突发负载压测：原来的管理者(3s 检查一次，每次增减 2 个) vs 自适应管理者
+// 每轮一次性提交一批阻塞型任务(usleep 模拟 I/O)，然后空闲一段时间，统计从提交到执行完的延迟分布
+// 用法: ./threadpool_bench [轮数=6] [每轮任务数=200] [任务耗时us=5000] [空闲ms=700]
+
+#define THREADPOOL_VERBOSE 0
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "ThreadPool.cpp"
+
+struct Job
+{
+    chrono::steady_clock::time_point submit;
+    long long *latencyUs;
+    atomic<int> *done;
+    int workUs;
+};
+
+void jobFunc(void *arg)
+{
+    Job *job = static_cast<Job *>(arg);
+    usleep(job->workUs);
+    *job->latencyUs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - job->submit).count();
+    job->done->fetch_add(1);
+}
+
+void run(const char *name, bool adaptive, int bursts, int perBurst, int workUs, int idleMs)
+{
+    ThreadPool<Job> pool(2, 32, adaptive);
+    vector<long long> latency(bursts * perBurst);
+    atomic<int> done(0);
+    int maxAlive = 0;
+    for (int b = 0; b < bursts; ++b)
+    {
+        for (int i = 0; i < perBurst; ++i)
+        {
+            Job *job = new Job{chrono::steady_clock::now(), &latency[b * perBurst + i], &done, workUs};
+            pool.addTask(jobFunc, job);
+        }
+        // 等这一轮做完，期间记录线程数
+        while (done.load() < (b + 1) * perBurst)
+        {
+            maxAlive = max(maxAlive, pool.getAliveNumber());
+            usleep(1000);
+        }
+        usleep(idleMs * 1000);
+    }
+    int aliveEnd = pool.getAliveNumber();
+    sort(latency.begin(), latency.end());
+    size_t n = latency.size();
+    printf("%-9s p50 %8.1f ms  p99 %8.1f ms  max %8.1f ms  peak threads %2d  threads after idle %2d\n", name,
+           latency[n / 2] / 1000.0, latency[n * 99 / 100] / 1000.0, latency[n - 1] / 1000.0, maxAlive, aliveEnd);
+}
+
+int main(int argc, char *argv[])
+{
+    int bursts = argc > 1 ? atoi(argv[1]) : 6;
+    int perBurst = argc > 2 ? atoi(argv[2]) : 200;
+    int workUs = argc > 3 ? atoi(argv[3]) : 5000;
+    int idleMs = argc > 4 ? atoi(argv[4]) : 700;
+    printf("bursts %d x %d tasks, %d us each, idle %d ms, threads 2..32\n", bursts, perBurst, workUs, idleMs);
+    run("legacy", false, bursts, perBurst, workUs, idleMs);
+    run("adaptive", true, bursts, perBurst, workUs, idleMs);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef __Callable__
+#define __Callable__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 只能移动的 void() 可调用对象，用作线程池的任务类型
+// 和 function<void()> 相比：不要求捕获可拷贝(可以捕获 promise 之类的对象)，
+// 捕获不超过 INLINE_SIZE 字节时存放在对象内部，不分配内存
+class Callable
+{
+public:
+    static const size_t INLINE_SIZE = 64;
+
+    Callable() noexcept : m_ops(nullptr) {}
+
+    template <typename F, typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, Callable>::value>::type>
+    Callable(F &&f) : m_ops(&OpsFor<Fn>::ops)
+    {
+        if constexpr (isInline<Fn>())
+            new (m_buf) Fn(std::forward<F>(f));
+        else
+            *reinterpret_cast<Fn **>(m_buf) = new Fn(std::forward<F>(f));
+    }
+
+    Callable(Callable &&other) noexcept : m_ops(other.m_ops)
+    {
+        if (m_ops)
+        {
+            m_ops->move(m_buf, other.m_buf);
+            other.m_ops = nullptr;
+        }
+    }
+
+    Callable &operator=(Callable &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            m_ops = other.m_ops;
+            if (m_ops)
+            {
+                m_ops->move(m_buf, other.m_buf);
+                other.m_ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Callable(const Callable &) = delete;
+    Callable &operator=(const Callable &) = delete;
+
+    ~Callable() { reset(); }
+
+    void operator()() { m_ops->call(m_buf); }
+
+    explicit operator bool() const { return m_ops != nullptr; }
+
+    void reset()
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(m_buf);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops
+    {
+        void (*call)(void *);
+        void (*move)(void *dst, void *src); // 移动到 dst 并析构 src
+        void (*destroy)(void *);
+    };
+
+    template <typename Fn>
+    static constexpr bool isInline()
+    {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template <typename Fn, bool = isInline<Fn>()>
+    struct OpsFor
+    {
+        static void call(void *p) { (*static_cast<Fn *>(p))(); }
+        static void move(void *dst, void *src)
+        {
+            new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+            static_cast<Fn *>(src)->~Fn();
+        }
+        static void destroy(void *p) { static_cast<Fn *>(p)->~Fn(); }
+        static constexpr Ops ops = {call, move, destroy};
+    };
+
+    // 放不下的存指针
+    template <typename Fn>
+    struct OpsFor<Fn, false>
+    {
+        static void call(void *p) { (**static_cast<Fn **>(p))(); }
+        static void move(void *dst, void *src) { *static_cast<Fn **>(dst) = *static_cast<Fn **>(src); }
+        static void destroy(void *p) { delete *static_cast<Fn **>(p); }
+        static constexpr Ops ops = {call, move, destroy};
+    };
+
+    alignas(std::max_align_t) unsigned char m_buf[INLINE_SIZE];
+    const Ops *m_ops;
+};
+
+#endif
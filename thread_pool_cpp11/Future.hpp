@@ -0,0 +1,526 @@
+#ifndef __Future__
+#define __Future__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Callable.hpp"
+
+// 轻量的 Promise/Future，配合线程池做流水线：
+// then 注册的后续任务在前一个结果就绪时投递到线程池执行，不需要有线程阻塞在 get() 上等；
+// whenAll/whenAny 把一组 Future 合成一个。共享状态按类型放在每线程的缓存里回收复用，
+// 后续任务存放在共享状态里的 Callable 中，小捕获不分配内存，所以稳定运行时每一级不需要 new。
+
+// 执行器接口，then 的后续任务通过它投递
+class Executor
+{
+public:
+    virtual ~Executor() {}
+    virtual void post(Callable task) = 0;
+};
+
+// void 的替身，Future<void> 用 Future<Unit> 表示
+struct Unit
+{
+};
+
+template <typename T>
+using lift_t = typename std::conditional<std::is_void<T>::value, Unit, T>::type;
+
+template <typename T>
+class Future;
+template <typename T>
+class Promise;
+
+namespace detail
+{
+template <typename T>
+struct SharedState;
+
+// 共享状态的回收池：先放当前线程的缓存，满了把一半挪到全局池；取的时候本线程缓存空了再从全局池成批拿。
+// 流水线里状态常在提交线程上创建、在工作线程上释放，有全局池这一层才能在线程之间流转复用
+template <typename T>
+class StatePool
+{
+public:
+    static const size_t CACHE_SIZE = 256;
+    static const size_t GLOBAL_SIZE = 4096; // 全局池上限，超过的直接 delete
+
+    static SharedState<T> *acquire()
+    {
+        auto &cache = local().states;
+        if (cache.empty())
+        {
+            Global &g = global();
+            std::lock_guard<std::mutex> lock(g.mutex);
+            size_t n = std::min(g.states.size(), CACHE_SIZE / 2);
+            cache.insert(cache.end(), g.states.end() - n, g.states.end());
+            g.states.resize(g.states.size() - n);
+        }
+        if (!cache.empty())
+        {
+            SharedState<T> *s = cache.back();
+            cache.pop_back();
+            return s;
+        }
+        return new SharedState<T>();
+    }
+
+    static void release(SharedState<T> *s)
+    {
+        s->reset();
+        auto &cache = local().states;
+        if (cache.size() == CACHE_SIZE)
+        {
+            Global &g = global();
+            std::lock_guard<std::mutex> lock(g.mutex);
+            size_t n = std::min(CACHE_SIZE / 2, GLOBAL_SIZE - g.states.size());
+            g.states.insert(g.states.end(), cache.end() - n, cache.end());
+            cache.resize(cache.size() - n);
+            if (cache.size() == CACHE_SIZE)
+            {
+                delete s;
+                return;
+            }
+        }
+        cache.push_back(s);
+    }
+
+private:
+    struct Cache
+    {
+        std::vector<SharedState<T> *> states;
+        Cache() { states.reserve(CACHE_SIZE); }
+        ~Cache()
+        {
+            for (auto s : states)
+                delete s;
+        }
+    };
+
+    struct Global
+    {
+        std::mutex mutex;
+        std::vector<SharedState<T> *> states;
+        Global() { states.reserve(GLOBAL_SIZE); }
+        ~Global()
+        {
+            for (auto s : states)
+                delete s;
+        }
+    };
+
+    static Cache &local()
+    {
+        thread_local Cache cache;
+        return cache;
+    }
+
+    static Global &global()
+    {
+        static Global g;
+        return g;
+    }
+};
+
+template <typename T>
+struct SharedState
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool ready = false;
+    int waiters = 0;  // 阻塞在 wait 上的线程数，没有就不 notify
+    bool hasValue = false;
+    std::exception_ptr error;
+    Callable continuation; // 就绪后执行一次
+    std::atomic<int> refs{0};
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T &value() { return *reinterpret_cast<T *>(storage); }
+
+    void addRef() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release()
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            StatePool<T>::release(this);
+    }
+
+    void reset()
+    {
+        if (hasValue)
+            value().~T();
+        hasValue = false;
+        error = nullptr;
+        ready = false;
+        continuation.reset();
+    }
+
+    template <typename U>
+    void setValue(U &&v)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            new (storage) T(std::forward<U>(v));
+            hasValue = true;
+            ready = true;
+        }
+        fire();
+    }
+
+    void setError(std::exception_ptr e)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = e;
+            ready = true;
+        }
+        fire();
+    }
+
+    // 就绪时执行 cb，已经就绪则在当前线程立即执行
+    void onReady(Callable cb)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ready)
+            {
+                continuation = std::move(cb);
+                return;
+            }
+        }
+        cb();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        waiters++;
+        cond.wait(lock, [this]() { return ready; });
+        waiters--;
+    }
+
+    bool isReady()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ready;
+    }
+
+private:
+    void fire()
+    {
+        Callable cb;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cb = std::move(continuation);
+            wake = waiters > 0;
+        }
+        if (wake)
+            cond.notify_all();
+        if (cb)
+            cb();
+    }
+};
+
+template <typename T>
+SharedState<T> *makeState(int refs)
+{
+    SharedState<T> *s = StatePool<T>::acquire();
+    s->refs.store(refs, std::memory_order_relaxed);
+    return s;
+}
+
+// 调用 f(value) 或 f()，返回值为 void 时换成 Unit
+template <typename F, typename T>
+auto invokeWith(F &f, T &&value)
+{
+    if constexpr (std::is_invocable<F &, T &&>::value)
+    {
+        if constexpr (std::is_void<std::invoke_result_t<F &, T &&>>::value)
+        {
+            f(std::forward<T>(value));
+            return Unit{};
+        }
+        else
+            return f(std::forward<T>(value));
+    }
+    else
+    {
+        if constexpr (std::is_void<std::invoke_result_t<F &>>::value)
+        {
+            f();
+            return Unit{};
+        }
+        else
+            return f();
+    }
+}
+
+template <typename F, typename T>
+using then_t = decltype(invokeWith(std::declval<F &>(), std::declval<T &&>()));
+
+// 执行 f 并把结果或异常写入 s
+template <typename R, typename F>
+void fulfill(SharedState<R> *s, F &&f)
+{
+    try
+    {
+        s->setValue(f());
+    }
+    catch (...)
+    {
+        s->setError(std::current_exception());
+    }
+}
+} // namespace detail
+
+template <typename T>
+class Future
+{
+public:
+    Future() : m_state(nullptr), m_executor(nullptr) {}
+    Future(Future &&other) noexcept : m_state(other.m_state), m_executor(other.m_executor) { other.m_state = nullptr; }
+    Future &operator=(Future &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_state)
+                m_state->release();
+            m_state = other.m_state;
+            m_executor = other.m_executor;
+            other.m_state = nullptr;
+        }
+        return *this;
+    }
+    Future(const Future &) = delete;
+    Future &operator=(const Future &) = delete;
+    ~Future()
+    {
+        if (m_state)
+            m_state->release();
+    }
+
+    bool valid() const { return m_state != nullptr; }
+    bool isReady() const { return m_state && m_state->isReady(); }
+    void wait() const { m_state->wait(); }
+
+    // 阻塞直到就绪，取走结果，之后 Future 失效
+    T get()
+    {
+        detail::SharedState<T> *s = m_state;
+        m_state = nullptr;
+        s->wait();
+        if (s->error)
+        {
+            std::exception_ptr e = s->error;
+            s->release();
+            std::rethrow_exception(e);
+        }
+        T v = std::move(s->value());
+        s->release();
+        return v;
+    }
+
+    // 结果就绪后把 f(结果) 投递到线程池执行，返回 f 的结果的 Future；f 也可以不接受参数。
+    // 前面出了异常则跳过 f，异常传给返回的 Future。调用后本 Future 失效
+    template <typename F>
+    Future<detail::then_t<F, T>> then(F &&f)
+    {
+        using R = detail::then_t<F, T>;
+        detail::SharedState<T> *s = m_state;
+        detail::SharedState<R> *next = detail::makeState<R>(2); // 返回的 Future 和后续任务各持一份
+        Executor *executor = m_executor;
+        m_state = nullptr;
+        s->onReady([s, next, executor, f = std::forward<F>(f)]() mutable {
+            Callable run = [s, next, f = std::move(f)]() mutable {
+                if (s->error)
+                    next->setError(s->error);
+                else
+                    detail::fulfill(next, [&]() { return detail::invokeWith(f, std::move(s->value())); });
+                s->release();
+                next->release();
+            };
+            if (executor)
+                executor->post(std::move(run));
+            else
+                run();
+        });
+        return Future<R>(next, executor);
+    }
+
+private:
+    template <typename U>
+    friend class Future;
+    template <typename U>
+    friend class Promise;
+    template <typename U>
+    friend Future<std::vector<U>> whenAll(std::vector<Future<U>> &futures);
+    template <typename U>
+    friend Future<std::pair<size_t, U>> whenAny(std::vector<Future<U>> &futures);
+
+    Future(detail::SharedState<T> *state, Executor *executor) : m_state(state), m_executor(executor) {}
+
+    detail::SharedState<T> *m_state;
+    Executor *m_executor; // then 的后续任务投递到这里，为空则在完成的线程上直接执行
+};
+
+template <typename T>
+class Promise
+{
+public:
+    explicit Promise(Executor *executor = nullptr)
+        : m_state(detail::makeState<T>(1)), m_executor(executor), m_retrieved(false)
+    {
+    }
+    Promise(Promise &&other) noexcept
+        : m_state(other.m_state), m_executor(other.m_executor), m_retrieved(other.m_retrieved)
+    {
+        other.m_state = nullptr;
+    }
+    Promise(const Promise &) = delete;
+    Promise &operator=(const Promise &) = delete;
+    ~Promise()
+    {
+        if (m_state)
+        {
+            // 没有设置结果就销毁，等待的一方收到 broken_promise
+            setError(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    Future<T> getFuture()
+    {
+        if (m_retrieved)
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        m_retrieved = true;
+        m_state->addRef();
+        return Future<T>(m_state, m_executor);
+    }
+
+    template <typename U>
+    void setValue(U &&v)
+    {
+        detail::SharedState<T> *s = take();
+        s->setValue(std::forward<U>(v));
+        s->release();
+    }
+
+    void setError(std::exception_ptr e)
+    {
+        detail::SharedState<T> *s = take();
+        s->setError(e);
+        s->release();
+    }
+
+private:
+    detail::SharedState<T> *take()
+    {
+        if (!m_state)
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        detail::SharedState<T> *s = m_state;
+        m_state = nullptr;
+        return s;
+    }
+
+    detail::SharedState<T> *m_state;
+    Executor *m_executor;
+    bool m_retrieved;
+};
+
+// 全部就绪后得到按原顺序排列的结果；任何一个出异常，结果就是第一个异常。调用后 futures 都失效
+template <typename T>
+Future<std::vector<T>> whenAll(std::vector<Future<T>> &futures)
+{
+    struct Gather
+    {
+        std::vector<T> results;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed{false};
+        detail::SharedState<std::vector<T>> *out;
+    };
+    Executor *executor = futures.empty() ? nullptr : futures[0].m_executor;
+    detail::SharedState<std::vector<T>> *out = detail::makeState<std::vector<T>>(2);
+    if (futures.empty())
+    {
+        out->setValue(std::vector<T>());
+        out->release();
+        return Future<std::vector<T>>(out, executor);
+    }
+    auto gather = std::make_shared<Gather>();
+    gather->results.resize(futures.size());
+    gather->remaining.store(futures.size());
+    gather->out = out;
+    for (size_t i = 0; i < futures.size(); ++i)
+    {
+        detail::SharedState<T> *s = futures[i].m_state;
+        futures[i].m_state = nullptr;
+        // 收集结果很轻，直接在完成的线程上做
+        s->onReady([s, i, gather]() {
+            if (s->error)
+            {
+                if (!gather->failed.exchange(true))
+                {
+                    gather->out->setError(s->error);
+                    gather->out->release();
+                }
+            }
+            else
+            {
+                gather->results[i] = std::move(s->value());
+            }
+            s->release();
+            if (gather->remaining.fetch_sub(1) == 1 && !gather->failed.load())
+            {
+                gather->out->setValue(std::move(gather->results));
+                gather->out->release();
+            }
+        });
+    }
+    futures.clear();
+    return Future<std::vector<T>>(out, executor);
+}
+
+// 第一个就绪的 Future 的下标和结果；第一个就绪的是异常则结果就是该异常。调用后 futures 都失效
+template <typename T>
+Future<std::pair<size_t, T>> whenAny(std::vector<Future<T>> &futures)
+{
+    using result_t = std::pair<size_t, T>;
+    Executor *executor = futures.empty() ? nullptr : futures[0].m_executor;
+    detail::SharedState<result_t> *out = detail::makeState<result_t>(2);
+    if (futures.empty())
+    {
+        out->setError(std::make_exception_ptr(std::future_error(std::future_errc::no_state)));
+        out->release();
+        return Future<result_t>(out, executor);
+    }
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    for (size_t i = 0; i < futures.size(); ++i)
+    {
+        detail::SharedState<T> *s = futures[i].m_state;
+        futures[i].m_state = nullptr;
+        s->onReady([s, i, out, done]() {
+            if (!done->exchange(true))
+            {
+                if (s->error)
+                    out->setError(s->error);
+                else
+                    out->setValue(result_t(i, std::move(s->value())));
+                out->release();
+            }
+            s->release();
+        });
+    }
+    futures.clear();
+    return Future<result_t>(out, executor);
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __Parallel__
+#define __Parallel__
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+#include "ThreadPool.hpp"
+
+// 建立在线程池上的并行算法：parallelFor / parallelReduce / parallelTransform / parallelSort
+// 不再一个元素提交一个任务，而是把区间对半递归切分：右半边投递到线程池，左半边在当前线程继续切，
+// 切到不大于粒度(grain)时串行处理。等待右半边时当前线程从队列里取任务帮忙执行，所以在工作线程里嵌套调用也不会死锁。
+// grain 传 0 时自动选取：大约每个线程分到 GRAIN_SPLITS 块，块数够负载均衡，又不会让任务开销占大头。
+// 迭代器都要求是随机访问迭代器。
+
+namespace detail
+{
+static const size_t GRAIN_SPLITS = 8; // 自动粒度下每个线程分到的块数
+
+inline size_t autoGrain(ThreadPool &pool, size_t n, size_t grain)
+{
+    if (grain > 0)
+        return grain;
+    size_t chunks = (size_t)std::max(1, pool.threadCount() + 1) * GRAIN_SPLITS; // 调用线程也参与
+    return std::max<size_t>(1, (n + chunks - 1) / chunks);
+}
+
+// 并行执行 left 和 right，两者都结束后返回；任何一边抛出的异常在这里重新抛出(两边都抛时取 left 的)
+template <typename Left, typename Right>
+void forkJoin(ThreadPool &pool, Left &&left, Right &&right)
+{
+    std::atomic<bool> done{false};
+    std::exception_ptr rightError;
+    pool.post([&right, &done, &rightError]() {
+        try
+        {
+            right();
+        }
+        catch (...)
+        {
+            rightError = std::current_exception();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::exception_ptr leftError;
+    try
+    {
+        left();
+    }
+    catch (...)
+    {
+        leftError = std::current_exception();
+    }
+
+    // right 还引用着本栈帧，必须等它结束
+    while (!done.load(std::memory_order_acquire))
+    {
+        if (!pool.runPending())
+            std::this_thread::yield();
+    }
+    if (leftError)
+        std::rethrow_exception(leftError);
+    if (rightError)
+        std::rethrow_exception(rightError);
+}
+
+template <typename Index, typename F>
+void forRange(ThreadPool &pool, Index first, Index last, F &f, size_t grain)
+{
+    if ((size_t)(last - first) <= grain)
+    {
+        for (Index i = first; i < last; ++i)
+            f(i);
+        return;
+    }
+    Index mid = first + (last - first) / 2;
+    forkJoin(pool, [&]() { forRange(pool, first, mid, f, grain); },
+             [&]() { forRange(pool, mid, last, f, grain); });
+}
+
+// 非空区间的归约，叶子从第一个元素开始累加，不需要单位元
+template <typename It, typename T, typename Op>
+T reduceRange(ThreadPool &pool, It first, It last, Op &op, size_t grain)
+{
+    if ((size_t)(last - first) <= grain)
+    {
+        T acc = *first;
+        for (++first; first != last; ++first)
+            acc = op(std::move(acc), *first);
+        return acc;
+    }
+    It mid = first + (last - first) / 2;
+    T leftValue{};
+    T rightValue{};
+    forkJoin(pool, [&]() { leftValue = reduceRange<It, T>(pool, first, mid, op, grain); },
+             [&]() { rightValue = reduceRange<It, T>(pool, mid, last, op, grain); });
+    return op(std::move(leftValue), std::move(rightValue));
+}
+
+// 两半分别排好序再原地归并
+template <typename It, typename Compare>
+void sortRange(ThreadPool &pool, It first, It last, Compare &comp, size_t grain)
+{
+    if ((size_t)(last - first) <= grain)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+    It mid = first + (last - first) / 2;
+    forkJoin(pool, [&]() { sortRange(pool, first, mid, comp, grain); },
+             [&]() { sortRange(pool, mid, last, comp, grain); });
+    std::inplace_merge(first, mid, last, comp);
+}
+} // namespace detail
+
+// 对 [first, last) 中的每个下标 i 执行 f(i)
+template <typename Index, typename F>
+void parallelFor(ThreadPool &pool, Index first, Index last, F &&f, size_t grain = 0)
+{
+    if (!(first < last))
+        return;
+    grain = detail::autoGrain(pool, (size_t)(last - first), grain);
+    detail::forRange(pool, first, last, f, grain);
+}
+
+// 用 op 归约 [first, last)，结果为 op(init, 各元素)；op 要满足结合律，各块的合并顺序不固定
+template <typename It, typename T, typename Op = std::plus<>>
+T parallelReduce(ThreadPool &pool, It first, It last, T init, Op op = Op(), size_t grain = 0)
+{
+    if (first == last)
+        return init;
+    grain = detail::autoGrain(pool, (size_t)(last - first), grain);
+    return op(std::move(init), detail::reduceRange<It, T>(pool, first, last, op, grain));
+}
+
+// out[i] = f(first[i])，返回输出区间的末尾
+template <typename InIt, typename OutIt, typename F>
+OutIt parallelTransform(ThreadPool &pool, InIt first, InIt last, OutIt out, F &&f, size_t grain = 0)
+{
+    auto n = last - first;
+    parallelFor(pool, decltype(n)(0), n, [&](decltype(n) i) { out[i] = f(first[i]); }, grain);
+    return out + n;
+}
+
+// 排序 [first, last)，不稳定排序的叶子 + 归并
+template <typename It, typename Compare = std::less<>>
+void parallelSort(ThreadPool &pool, It first, It last, Compare comp = Compare(), size_t grain = 0)
+{
+    if (last - first < 2)
+        return;
+    grain = detail::autoGrain(pool, (size_t)(last - first), grain);
+    detail::sortRange(pool, first, last, comp, grain);
+}
+
+#endif
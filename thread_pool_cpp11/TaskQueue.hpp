@@ -1,63 +1,225 @@
 #ifndef __TaskQueue__
 #define __TaskQueue__
 
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <queue>
-#include <thread>
-#include <chrono>
-#include <unistd.h>
-#include <functional>
+#include <utility>
+#include <vector>
 
+// 任务优先级，数值越小越优先
+enum class TaskPriority
+{
+    High = 0,
+    Normal = 1,
+    Low = 2,
+};
+
+// 任务队列，队列本身和"空了就等"共用一把锁和一个条件变量：
+// 取任务的线程在同一次加锁里完成等待和出队，不会出现被唤醒后再去抢第二把锁、发现已经被别人取走的情况。
+// 只在队列由空变为非空时叫醒一个线程，被叫醒的线程取走任务后看到还有剩余再接力叫醒下一个，
+// 避免生产者每次入队都唤醒一个线程来和自己抢锁。
+// 队列分优先级：每级一个 FIFO，带截止时间的任务进小顶堆，取任务时比较各级队头和堆顶的有效截止时间取最早的。
+// 普通任务的有效截止时间是 入队时间 + 该级的老化时间，低优先级任务等久了会排到新来的高优先级任务前面，不会饿死。
+// 关闭后仍然把剩下的任务取完，执行中的任务新投递的也算；队列空了且没有任务在执行(排空)之后才拒绝入队
 template <typename T>
 class TaskQueue
 {
+public:
+    using clock_t = std::chrono::steady_clock;
+
 private:
-    std::queue<T> m_queue; // 利用模板函数构造队列
-    std::mutex m_mutex;    // 访问互斥信号量
+    static const int LEVELS = 3;
+
+    struct Entry
+    {
+        clock_t::time_point due; // 有效截止时间
+        unsigned long seq;       // 入队序号，有效截止时间相同时先入队的先出
+        T task;
+    };
+
+    // a 是否应该排在 b 后面
+    static bool later(const Entry &a, const Entry &b)
+    {
+        return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+    }
+
+    static clock_t::duration agingTime(TaskPriority priority)
+    {
+        static const clock_t::duration AGING[LEVELS] = {std::chrono::milliseconds(0), std::chrono::milliseconds(20),
+                                                        std::chrono::milliseconds(200)};
+        return AGING[static_cast<int>(priority)];
+    }
+
+    std::queue<Entry> m_levels[LEVELS]; // 每个优先级一个队列
+    std::vector<Entry> m_deadlines;     // 带截止时间的任务，按 due 的小顶堆
+    size_t m_size;                      // 任务总数
+    unsigned long m_seq;
+    std::mutex m_mutex;                 // 访问互斥信号量
+    std::condition_variable m_notEmpty; // 队列非空或关闭时通知
+    int m_waiting;                      // 阻塞在 waitDequeue 里的线程数，没有就不 notify
+    int m_running;                      // waitDequeue 取走、还没调用 taskDone 的任务数
+    bool m_closed;                      // 关闭后 waitDequeue 排空了就不再阻塞
+
+    // 关闭并排空，之后不会再有线程来取任务
+    bool drained() const { return m_closed && m_size == 0 && m_running == 0; }
+
+    // 放入任务并按需唤醒一个等待的线程，已排空时不放入(entry 保持原样)并返回 false
+    bool push(Entry &&entry, int level)
+    {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (drained())
+                return false;
+            wake = m_size == 0 && m_waiting > 0;
+            entry.seq = m_seq++;
+            if (level < 0)
+            {
+                m_deadlines.push_back(std::move(entry));
+                std::push_heap(m_deadlines.begin(), m_deadlines.end(), later);
+            }
+            else
+            {
+                m_levels[level].push(std::move(entry));
+            }
+            m_size++;
+        }
+        if (wake)
+            m_notEmpty.notify_one();
+        return true;
+    }
+
+    // 取出有效截止时间最早的任务，调用时持有锁且队列非空
+    void pop(T &t)
+    {
+        const Entry *best = m_deadlines.empty() ? nullptr : &m_deadlines.front();
+        int level = -1;
+        for (int i = 0; i < LEVELS; i++)
+        {
+            if (!m_levels[i].empty() && (best == nullptr || later(*best, m_levels[i].front())))
+            {
+                best = &m_levels[i].front();
+                level = i;
+            }
+        }
+        if (level < 0)
+        {
+            std::pop_heap(m_deadlines.begin(), m_deadlines.end(), later);
+            t = std::move(m_deadlines.back().task);
+            m_deadlines.pop_back();
+        }
+        else
+        {
+            t = std::move(m_levels[level].front().task);
+            m_levels[level].pop();
+        }
+        m_size--;
+    }
 
 public:
-    TaskQueue(){};
-    ~TaskQueue(){};
+    TaskQueue() : m_size(0), m_seq(0), m_waiting(0), m_running(0), m_closed(false) {}
+    ~TaskQueue() {}
 
     bool empty() // 返回队列是否为空
     {
-        std::lock_guard<std::mutex> lock(m_mutex); // 互斥信号变量加锁，防止m_queue被改变
-        return m_queue.empty();
+        std::lock_guard<std::mutex> lock(m_mutex); // 互斥信号变量加锁，防止队列被改变
+        return m_size == 0;
     }
 
     int size()
     {
-        std::lock_guard<std::mutex> lock(m_mutex); // 互斥信号变量加锁，防止m_queue被改变
-        return m_queue.size();
+        std::lock_guard<std::mutex> lock(m_mutex); // 互斥信号变量加锁，防止队列被改变
+        return m_size;
+    }
+
+    // 队列添加元素 传入左值，已排空返回 false
+    bool enqueue(T &t, TaskPriority priority = TaskPriority::Normal)
+    {
+        T copy(t);
+        return enqueue(std::move(copy), priority);
     }
 
-    // 队列添加元素 传入左值
-    void enqueue(T &t)
+    // 队列添加元素 传入右值，已排空返回 false，t 保持原样
+    bool enqueue(T &&t, TaskPriority priority = TaskPriority::Normal)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_queue.emplace(t);
+        Entry entry{clock_t::now() + agingTime(priority), 0, std::move(t)};
+        if (push(std::move(entry), static_cast<int>(priority)))
+            return true;
+        t = std::move(entry.task);
+        return false;
     }
 
-    // 队列添加元素 传入右值
-    void enqueue(T &&t)
+    // 添加带截止时间的任务，按截止时间最早优先和其他任务一起调度；已排空返回 false，t 保持原样
+    bool enqueueBefore(T &&t, clock_t::time_point deadline)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_queue.emplace(std::move(t));
+        Entry entry{deadline, 0, std::move(t)};
+        if (push(std::move(entry), -1))
+            return true;
+        t = std::move(entry.task);
+        return false;
     }
 
-    // 队列取出元素
+    // 队列取出元素，队列为空立即返回 false
     bool dequeue(T &t)
     {
         std::lock_guard<std::mutex> lock(m_mutex);  // 队列加锁
-        if (m_queue.empty())
+        if (m_size == 0)
         {
             return false;
         }
-        t = std::move(m_queue.front()); // 取出队首元素，返回队首元素值，并进行右值引用
-        m_queue.pop();                  // 弹出入队的第一个元素
+        pop(t);
         return true;
     }
+
+    // 队列取出元素，队列为空则阻塞等待；关闭后继续取剩下的任务，排空了才返回 false。
+    // 取到的任务执行完(连同析构)要调用 taskDone，期间它投递的后续任务也会被取走执行
+    bool waitDequeue(T &t)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_size == 0 && !drained())
+        {
+            m_waiting++;
+            m_notEmpty.wait(lock);
+            m_waiting--;
+        }
+        if (m_size == 0)
+        {
+            return false;
+        }
+        pop(t);
+        m_running++;
+        bool wake = m_size > 0 && m_waiting > 0;
+        lock.unlock();
+        if (wake)
+            m_notEmpty.notify_one(); // 还有任务，接力叫醒下一个
+        return true;
+    }
+
+    // waitDequeue 取走的任务执行完了，关闭后最后一个任务完成时唤醒所有等待的线程退出
+    void taskDone()
+    {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running--;
+            wake = drained() && m_waiting > 0;
+        }
+        if (wake)
+            m_notEmpty.notify_all();
+    }
+
+    // 关闭队列，唤醒所有等待的线程
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
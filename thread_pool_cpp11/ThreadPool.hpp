@@ -1,106 +1,86 @@
 #ifndef __ThreadPool__
 #define __ThreadPool__
 
-#include <mutex>
-#include <queue>
 #include <functional>
 #include <future>
+#include <ostream>
 #include <thread>
 #include <utility>
 #include <vector>
+#include <tuple>
 #include <chrono>
+#include <type_traits>
 
+#include "Callable.hpp"
+#include "Future.hpp"
 #include "TaskQueue.hpp"
+#include "Trace.hpp"
 using namespace std;
 
-class ThreadPool
+// Tracing 为 true 时工作线程往 TraceRing 里记事件，平时通过下面的 ThreadPool 别名按 THREADPOOL_TRACE 选择
+template <bool Tracing>
+class BasicThreadPool : public Executor
 {
-    using task_t = function<void()>;
+    using task_t = Callable;
+    using trace_t = typename conditional<Tracing, TraceRing, NullTrace>::type;
 
 private:
-    vector<thread> m_threads;      // 工作线程队列
-    TaskQueue<task_t> m_queue;     // 任务队列
-    condition_variable m_notEmpty; // 条件变量
-    mutex m_mutex;                 // 互斥锁
-    mutex m_printmutex;            // 打印用的互斥锁，防止抢占输出
-    bool m_shutdown;               // 是否关闭
+    vector<thread> m_threads;  // 工作线程队列
+    TaskQueue<task_t> m_queue; // 任务队列，等待任务也在队列内部完成
+    trace_t m_trace;           // 调试跟踪的事件缓冲，关闭跟踪时是空的 NullTrace
+
+    void trace(int id, TraceEvent event)
+    {
+        m_trace.record(id, event);
+    }
 
     // 线程对应的工作函数----取任务，执行任务
-    static void worker(ThreadPool *pool, const int id)
+    static void worker(BasicThreadPool *pool, const int id)
     {
-        task_t task;   // 定义任务 task
-        bool dequeued; // 是否成功取出队列中元素
-        this_thread::sleep_for(chrono::seconds(1));
-        while (!pool->m_shutdown)
+        task_t task; // 定义任务 task
+        pool->trace(id, TraceEvent::Start);
+        // 队列为空时在队列内部阻塞，关闭并排空后返回 false
+        while (pool->m_queue.waitDequeue(task))
         {
-            {
-                // 为线程环境加锁，互访问工作线程的休眠和唤醒
-                unique_lock<mutex> lock(pool->m_mutex);
-
-                // 如果任务队列为空，阻塞当前线程
-                pool->m_notEmpty.wait(lock, [&]()
-                                      {
-                    unique_lock<mutex> lock(pool->m_printmutex);
-                    if( pool->m_shutdown)
-                        cout << "Thread " << id + 1 << " is Call to Destroy..." << endl;
-                    else if(pool->m_queue.empty())
-                        cout << "Thread " << id + 1 << " is waiting..." << endl;
-                    return pool->m_shutdown || !pool->m_queue.empty(); });
-            }
-
-            // 取出任务队列中的元素
-            dequeued = pool->m_queue.dequeue(task);
-            // 如果成功取出，执行工作函数
-            if (dequeued)
-            {
-                {
-                    unique_lock<mutex> lock(pool->m_printmutex);
-                    cout << "Thread " << id + 1 << " is working..." << endl;
-                }
-                task();
-                {
-                    unique_lock<mutex> lock(pool->m_printmutex);
-                    cout << "Thread " << id + 1 << " is finished..." << endl;
-                }
-            }
+            pool->trace(id, TraceEvent::Begin);
+            task();
+            task.reset(); // 捕获的对象在这里析构，而不是拖到取下一个任务时
+            pool->m_queue.taskDone();
+            pool->trace(id, TraceEvent::End);
         }
+        pool->trace(id, TraceEvent::Exit);
     }
 
 public:
     // 线程池构造函数
-    ThreadPool(int n_threads = 4) : m_shutdown(false)
+    BasicThreadPool(int n_threads = 4)
     {
         for (int i = 0; i < n_threads; ++i)
         {
             m_threads.emplace_back(thread(worker, this, i)); // 创建工作线程
-            unique_lock<mutex> lock(m_printmutex);
-            cout << "Creating " << i + 1 << "th Threads" << endl;
         }
     }
 
     // 线程池析构函数
-    ~ThreadPool()
+    ~BasicThreadPool()
     {
-        m_shutdown = true;
-        // 唤醒所有工作线程销毁自己
-        {
-            unique_lock<mutex> lock(m_printmutex);
-            cout << "Waking Thread to Release the pool..." << endl;
-        }
-        m_notEmpty.notify_all();
+        // 关闭队列，工作线程把剩下的任务(包括它们投递的 then 后续任务)执行完再退出
+        m_queue.close();
 
         // 等待所有线程结束工作
-        for (int i = 0; i < m_threads.size(); ++i)
+        for (size_t i = 0; i < m_threads.size(); ++i)
         {
             if (m_threads.at(i).joinable())
             {
                 m_threads.at(i).join();
             }
         }
-        {
-            unique_lock<mutex> lock(m_printmutex);
-            cout << "The Pool has been Released!" << endl;
-        }
+    }
+
+    // 输出跟踪记录，THREADPOOL_TRACE 为 0 时什么也不输出
+    void dumpTrace(ostream &os)
+    {
+        m_trace.dump(os);
     }
 
     // 线程池提交任务函数
@@ -130,12 +110,76 @@ public:
 // 简化版本
         // auto task_ptr = make_shared<packaged_task<return_t()>>(bind(forward<F>(f), forward<Args>(args)...));
         auto task_ptr = make_shared<packaged_task<return_t()>>([f,args...](){ return f(args...);});
-        m_queue.enqueue([task_ptr](){(*task_ptr)();});
+        post([task_ptr](){(*task_ptr)();});
 // 结束
 
-        m_notEmpty.notify_one();
         return task_ptr->get_future();
     }
+
+    // 工作线程数
+    int threadCount() const { return (int)m_threads.size(); }
+
+    // 在当前线程上取一个排队的任务执行，没有任务返回 false。
+    // 分治算法等待子任务时调用它帮忙干活，而不是让线程阻塞(工作线程全阻塞住就死锁了)
+    bool runPending()
+    {
+        task_t task;
+        if (!m_queue.dequeue(task))
+            return false;
+        task();
+        return true;
+    }
+
+    // 投递一个任务，不返回结果，Future::then 的后续任务经由这里进入线程池。
+    // 线程池已经关闭且排空(工作线程都退出了)时在当前线程直接执行，不会留下没人执行的任务
+    void post(Callable task) override
+    {
+        if (!m_queue.enqueue(std::move(task)))
+            task();
+    }
+
+    // 按优先级投递，高优先级的任务在一批低优先级的慢任务之后提交也能先执行
+    void post(Callable task, TaskPriority priority)
+    {
+        if (!m_queue.enqueue(std::move(task), priority))
+            task();
+    }
+
+    // 带截止时间投递，截止时间越早越先执行
+    void postBefore(Callable task, chrono::steady_clock::time_point deadline)
+    {
+        if (!m_queue.enqueueBefore(std::move(task), deadline))
+            task();
+    }
+
+    // 和 submit 一样提交任务，但返回本线程池的 Future：可以用 then 接后续任务、用 whenAll/whenAny 合并，
+    // 不必阻塞在 get() 上。返回 void 的任务得到 Future<Unit>
+    template <typename F, typename... Args>
+    auto async(F &&f, Args &&...args) -> Future<lift_t<decltype(f(args...))>>
+    {
+        using return_t = lift_t<decltype(f(args...))>;
+        Promise<return_t> promise(this);
+        Future<return_t> future = promise.getFuture();
+        post([promise = std::move(promise), f = std::forward<F>(f), args = make_tuple(std::forward<Args>(args)...)]() mutable {
+            try
+            {
+                if constexpr (std::is_void<decltype(std::apply(f, args))>::value)
+                {
+                    std::apply(f, args);
+                    promise.setValue(Unit{});
+                }
+                else
+                    promise.setValue(std::apply(f, std::move(args)));
+            }
+            catch (...)
+            {
+                promise.setError(std::current_exception());
+            }
+        });
+        return future;
+    }
 };
 
+using ThreadPool = BasicThreadPool<THREADPOOL_TRACE != 0>;
+
 #endif
\ No newline at end of file
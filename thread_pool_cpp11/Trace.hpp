@@ -0,0 +1,96 @@
+#ifndef __Trace__
+#define __Trace__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// 线程池的调试跟踪。原来工作线程每步都加打印锁写 cout，现在改为往无锁环形缓冲里记事件，需要时再 dump 出来。
+// 默认编译掉(THREADPOOL_TRACE 为 0，线程池用 NullTrace)，热路径上没有任何开销；调试时在包含 ThreadPool.hpp 之前定义为 1。
+// 开关是线程池的模板参数，不同设置的翻译单元得到的是不同的类型，不会出现同名的类布局不一致
+#ifndef THREADPOOL_TRACE
+#define THREADPOOL_TRACE 0
+#endif
+
+enum class TraceEvent : uint8_t
+{
+    Start, // 工作线程启动
+    Begin, // 开始执行一个任务
+    End,   // 任务执行完
+    Exit,  // 工作线程退出
+};
+
+// 关闭跟踪时的替身，什么也不记
+struct NullTrace
+{
+    void record(int, TraceEvent) {}
+    void dump(std::ostream &) {}
+};
+
+// 多写者环形缓冲，写满后覆盖最旧的记录。
+// 每条记录带一个序号：写入前置为 2 * 位置 + 1，写完置为 2 * 位置 + 2，读者据此跳过写了一半或已被覆盖的记录
+class TraceRing
+{
+public:
+    static const size_t CAPACITY = 4096; // 2 的幂
+
+    TraceRing() : m_next(0), m_start(std::chrono::steady_clock::now())
+    {
+        for (auto &r : m_records)
+            r.seq.store(0, std::memory_order_relaxed);
+    }
+
+    void record(int thread, TraceEvent event)
+    {
+        uint64_t pos = m_next.fetch_add(1, std::memory_order_relaxed);
+        Record &r = m_records[pos & (CAPACITY - 1)];
+        r.seq.store(2 * pos + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        r.timeUs.store(elapsedUs(), std::memory_order_relaxed);
+        r.thread.store(thread, std::memory_order_relaxed);
+        r.event.store(event, std::memory_order_relaxed);
+        r.seq.store(2 * pos + 2, std::memory_order_release);
+    }
+
+    // 按时间顺序输出仍在缓冲里的记录
+    void dump(std::ostream &os)
+    {
+        static const char *names[] = {"start", "begin", "end", "exit"};
+        uint64_t end = m_next.load(std::memory_order_acquire);
+        uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+        for (uint64_t pos = begin; pos < end; ++pos)
+        {
+            Record &r = m_records[pos & (CAPACITY - 1)];
+            if (r.seq.load(std::memory_order_acquire) != 2 * pos + 2)
+                continue;
+            uint64_t timeUs = r.timeUs.load(std::memory_order_relaxed);
+            int thread = r.thread.load(std::memory_order_relaxed);
+            TraceEvent event = r.event.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (r.seq.load(std::memory_order_relaxed) != 2 * pos + 2)
+                continue;
+            os << "[" << timeUs << "us] Thread " << thread + 1 << " " << names[(int)event] << "\n";
+        }
+    }
+
+private:
+    struct Record
+    {
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> timeUs;
+        std::atomic<int> thread;
+        std::atomic<TraceEvent> event;
+    };
+
+    uint64_t elapsedUs() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    Record m_records[CAPACITY];
+    std::atomic<uint64_t> m_next;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
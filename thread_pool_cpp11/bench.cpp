@@ -0,0 +1,174 @@
+// 并行算法压测：串行 STL vs std::execution::par(有 TBB 时) vs 线程池上的 parallelFor/Reduce/Transform/Sort
+// 每项取 REPEAT 次中最快的一次，单位 ms；speedup 为串行耗时 / 线程池耗时
+// 之后是小任务吞吐：一个线程连续投递空任务，统计 post/submit/async 每秒执行完的任务数；
+// 最后是突发慢任务下的延迟：一批低优先级慢任务之后陆续投递短任务，比较短任务和慢任务同为低优先级(即先进先出)与短任务用高优先级投递时的排队时间
+// 用法: ./threadpool_bench [元素个数=4194304] [线程数=硬件线程数] [小任务个数=1000000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#if HAVE_STD_PAR
+#include <execution>
+#endif
+
+#include "Parallel.hpp"
+
+static const int REPEAT = 3;
+
+// 每次计时前先调用 reset 恢复输入(不计入耗时)，保证每次都处理同一份数据
+template <typename R, typename F>
+double bestMs(R &&reset, F &&f)
+{
+    double best = 1e100;
+    for (int r = 0; r < REPEAT; ++r)
+    {
+        reset();
+        auto start = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+template <typename F>
+double bestMs(F &&f)
+{
+    return bestMs([]() {}, f);
+}
+
+static void row(const char *name, double serial, double par, double pool)
+{
+    if (par < 0)
+        printf("%-10s %10.2f %10s %10.2f %8.2fx\n", name, serial, "-", pool, serial / pool);
+    else
+        printf("%-10s %10.2f %10.2f %10.2f %8.2fx\n", name, serial, par, pool, serial / pool);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = argc > 1 ? atol(argv[1]) : (1 << 22);
+    int threads = argc > 2 ? atoi(argv[2]) : max(1u, thread::hardware_concurrency());
+    long smallTasks = argc > 3 ? atol(argv[3]) : 1000000;
+    ThreadPool pool(threads);
+
+    vector<double> data(n);
+    vector<double> out(n);
+    vector<int> keys(n);
+    mt19937 rng(42);
+    for (size_t i = 0; i < n; ++i)
+    {
+        data[i] = rng() % 1000 / 10.0;
+        keys[i] = (int)rng();
+    }
+    auto heavy = [](double x) { return sqrt(x) * sin(x) + cos(x); };
+    double par = -1;
+
+    printf("elements %zu, threads %d (ms, best of %d)\n", n, threads, REPEAT);
+    printf("%-10s %10s %10s %10s %9s\n", "algorithm", "serial", "std::par", "pool", "speedup");
+
+    // for：原地更新每个元素，每次都从 data 重新拷贝
+    auto refill = [&]() { out = data; };
+    double serial = bestMs(refill, [&]() { for_each(out.begin(), out.end(), [&](double &x) { x = heavy(x); }); });
+#if HAVE_STD_PAR
+    par = bestMs(refill,
+                 [&]() { for_each(execution::par, out.begin(), out.end(), [&](double &x) { x = heavy(x); }); });
+#endif
+    double mine =
+        bestMs(refill, [&]() { parallelFor(pool, size_t(0), n, [&](size_t i) { out[i] = heavy(out[i]); }); });
+    row("for", serial, par, mine);
+
+    // reduce：求和
+    volatile double sink = 0;
+    serial = bestMs([&]() { sink = accumulate(data.begin(), data.end(), 0.0); });
+#if HAVE_STD_PAR
+    par = bestMs([&]() { sink = reduce(execution::par, data.begin(), data.end(), 0.0); });
+#endif
+    mine = bestMs([&]() { sink = parallelReduce(pool, data.begin(), data.end(), 0.0); });
+    row("reduce", serial, par, mine);
+
+    // transform
+    serial = bestMs([&]() { transform(data.begin(), data.end(), out.begin(), heavy); });
+#if HAVE_STD_PAR
+    par = bestMs([&]() { transform(execution::par, data.begin(), data.end(), out.begin(), heavy); });
+#endif
+    mine = bestMs([&]() { parallelTransform(pool, data.begin(), data.end(), out.begin(), heavy); });
+    row("transform", serial, par, mine);
+
+    // sort：每次都排同一份乱序数据
+    vector<int> work(n);
+    auto reshuffle = [&]() { work = keys; };
+    serial = bestMs(reshuffle, [&]() { sort(work.begin(), work.end()); });
+#if HAVE_STD_PAR
+    par = bestMs(reshuffle, [&]() { sort(execution::par, work.begin(), work.end()); });
+#endif
+    mine = bestMs(reshuffle, [&]() { parallelSort(pool, work.begin(), work.end()); });
+    row("sort", serial, par, mine);
+    if (!is_sorted(work.begin(), work.end()))
+        printf("parallelSort result is not sorted!\n");
+
+    // 小任务吞吐
+    atomic<long> done(0);
+    auto rate = [&](auto &&submitAll) {
+        done.store(0);
+        auto start = chrono::steady_clock::now();
+        submitAll();
+        while (done.load() < smallTasks)
+            this_thread::yield();
+        return smallTasks / chrono::duration<double>(chrono::steady_clock::now() - start).count() / 1e6;
+    };
+    auto task = [&done]() { done.fetch_add(1, memory_order_relaxed); };
+    double postRate = rate([&]() {
+        for (long i = 0; i < smallTasks; ++i)
+            pool.post(task);
+    });
+    double submitRate = rate([&]() {
+        for (long i = 0; i < smallTasks; ++i)
+            pool.submit(task);
+    });
+    double asyncRate = rate([&]() {
+        for (long i = 0; i < smallTasks; ++i)
+            pool.async(task);
+    });
+    printf("\nsmall tasks %ld (Mtasks/s): post %.3f, submit %.3f, async %.3f\n", smallTasks, postRate, submitRate,
+           asyncRate);
+
+    // 突发慢任务下短任务的排队时间
+    const int slowTasks = 50 * threads, fastTasks = 40;
+    auto burst = [&](TaskPriority fastPriority) {
+        vector<double> waits(fastTasks);
+        done.store(0);
+        for (int i = 0; i < slowTasks; ++i)
+        {
+            pool.post([&done]() {
+                this_thread::sleep_for(chrono::milliseconds(2));
+                done.fetch_add(1);
+            }, TaskPriority::Low);
+        }
+        for (int i = 0; i < fastTasks; ++i)
+        {
+            auto submitTime = chrono::steady_clock::now();
+            pool.post([&done, &waits, i, submitTime]() {
+                waits[i] = chrono::duration<double, milli>(chrono::steady_clock::now() - submitTime).count();
+                done.fetch_add(1);
+            }, fastPriority);
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+        while (done.load() < slowTasks + fastTasks)
+            this_thread::sleep_for(chrono::milliseconds(1));
+        double avg = accumulate(waits.begin(), waits.end(), 0.0) / fastTasks;
+        return make_pair(avg, *max_element(waits.begin(), waits.end()));
+    };
+    auto fifo = burst(TaskPriority::Low);
+    auto high = burst(TaskPriority::High);
+    printf("\nburst of %d slow low priority tasks, %d short tasks every 5ms (wait ms)\n", slowTasks, fastTasks);
+    printf("short tasks fifo: avg %.2f max %.2f; high priority: avg %.2f max %.2f\n", fifo.first, fifo.second,
+           high.first, high.second);
+
+    return 0;
+}
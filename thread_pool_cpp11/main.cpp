@@ -5,8 +5,12 @@
 // 2024.02.29完成
 // 缺点：没有实现管理者线程，增加线程容易，如何删除线程呢，使用哈希表存储id和线程。
 
+// 演示程序打开跟踪，最后输出各工作线程的事件
+#define THREADPOOL_TRACE 1
+
 #include <iostream>
 #include <thread>
+#include <unistd.h>
 
 #include "TaskQueue.hpp"
 #include "ThreadPool.hpp"
@@ -43,6 +47,22 @@ int main(int, char **)
 
     cout << "sum = " << sum << endl;
 
+    // 用 async/then/whenAll 做同样的事：每段求和之后接一个平方，最后合并，中途不阻塞任何线程
+    vector<Future<int>> parts;
+    for (int i = 0; i < n; i++)
+    {
+        parts.emplace_back(pool.async(fun, i * 5 + 1, (i + 1) * 5).then([](int s) { return s * s; }));
+    }
+    Future<int> total = whenAll(parts).then([](vector<int> v) {
+        int s = 0;
+        for (int x : v)
+            s += x;
+        return s;
+    });
+    cout << "sum of squares = " << total.get() << endl;
+
+    pool.dumpTrace(cout);
+
     sleep(1);
 
     return 0;
@@ -0,0 +1,111 @@
+// 析构线程池时还有排队的 async(...).then(...) 任务：
+// 工作线程要把剩下的任务和它们投递的后续任务都执行完再退出，不能丢，也不能在线程池析构之后再往里投递。
+// 跑不过时返回非 0，供 ctest 使用
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+#include "ThreadPool.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, long got, long want)
+{
+    if (!ok)
+    {
+        printf("FAILED: %s: got %ld, want %ld\n", what, got, want);
+        failures++;
+    }
+}
+
+// 每个 async 后面接两级 then，析构时大部分还在排队
+static void pendingThenChains()
+{
+    const int n = 2000;
+    atomic<int> first(0), second(0);
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < n; i++)
+        {
+            pool.async([i]() {
+                    this_thread::sleep_for(chrono::microseconds(i % 8 == 0 ? 100 : 0));
+                    return i;
+                })
+                .then([&first](int v) {
+                    first++;
+                    return v + 1;
+                })
+                .then([&second](int) { second++; });
+        }
+    }
+    check(first == n, "first then ran", first, n);
+    check(second == n, "second then ran", second, n);
+}
+
+// 任务在析构开始之后才投递新的任务
+static void postDuringShutdown()
+{
+    const int n = 100;
+    atomic<int> ran(0);
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < n; i++)
+        {
+            pool.post([&pool, &ran]() {
+                this_thread::sleep_for(chrono::microseconds(50));
+                pool.post([&ran]() { ran++; });
+            });
+        }
+    }
+    check(ran == n, "nested post ran", ran, n);
+}
+
+// 析构之后所有 Future 都已就绪，任务抛出的异常沿 then 传下来，而不是变成 broken_promise
+static void errorsDuringShutdown()
+{
+    const int n = 200;
+    vector<Future<int>> futures;
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < n; i++)
+        {
+            futures.push_back(pool.async([]() -> int { throw runtime_error("boom"); }).then([](int v) {
+                return v;
+            }));
+        }
+    }
+    int ready = 0, handled = 0;
+    for (auto &f : futures)
+    {
+        ready += f.isReady();
+        try
+        {
+            f.get();
+        }
+        catch (const runtime_error &)
+        {
+            handled++;
+        }
+        catch (...)
+        {
+        }
+    }
+    check(ready == n, "futures ready after shutdown", ready, n);
+    check(handled == n, "errors propagated", handled, n);
+}
+
+int main()
+{
+    for (int round = 0; round < 20; round++)
+    {
+        pendingThenChains();
+        postDuringShutdown();
+    }
+    errorsDuringShutdown();
+    if (failures == 0)
+        printf("shutdown_test passed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+// 简易 HTTP 压测客户端，用来对比 "Reactor + 线程池" 与 "one loop per thread" 两种模式的 QPS
+// 单线程 epoll 驱动若干条 keep-alive 连接，每条连接收到完整响应后立刻发出下一个请求。
+// 用法: http_bench <ip> <port> [连接数=64] [秒数=10] [路径=/index.html] [pipeline深度=1]
+// 例如先 ./webserver 启动默认模式测一次，再 ./webserver 4 启动 4 个从 Reactor 测一次。
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+struct Conn
+{
+    int fd = -1;
+    int outstanding = 0; // 已发出但还没收到响应的请求数
+    std::string in;
+};
+
+static sockaddr_in g_addr;
+static std::string g_request;
+static int g_pipeline = 1;
+static long g_done = 0;
+static long g_errors = 0;
+static long long g_bytes = 0;
+
+static int Connect(int epfd, Conn &c)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (sockaddr *)&g_addr, sizeof(g_addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    c.fd = fd;
+    c.outstanding = 0;
+    c.in.clear();
+    epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &c;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    return fd;
+}
+
+static void SendBatch(Conn &c)
+{
+    std::string out;
+    for (int i = 0; i < g_pipeline; i++)
+    {
+        out += g_request;
+    }
+    // 请求很小，阻塞式地写完即可
+    size_t sent = 0;
+    while (sent < out.size())
+    {
+        ssize_t n = send(c.fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EAGAIN)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            g_errors++;
+            return;
+        }
+        sent += n;
+    }
+    c.outstanding = g_pipeline;
+}
+
+// 从 c.in 中取出所有完整响应，返回取出的个数
+static int ConsumeResponses(Conn &c)
+{
+    int cnt = 0;
+    while (true)
+    {
+        size_t headEnd = c.in.find("\r\n\r\n");
+        if (headEnd == std::string::npos)
+        {
+            break;
+        }
+        size_t bodyLen = 0;
+        const char *p = strcasestr(c.in.c_str(), "content-length:");
+        if (p && (size_t)(p - c.in.c_str()) < headEnd)
+        {
+            bodyLen = strtoul(p + 15, nullptr, 10);
+        }
+        size_t total = headEnd + 4 + bodyLen;
+        if (c.in.size() < total)
+        {
+            break;
+        }
+        g_bytes += total;
+        c.in.erase(0, total);
+        cnt++;
+    }
+    return cnt;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <ip> <port> [conns=64] [seconds=10] [path=/index.html] [pipeline=1]\n", argv[0]);
+        return 1;
+    }
+    int conns = argc > 3 ? atoi(argv[3]) : 64;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    const char *path = argc > 5 ? argv[5] : "/index.html";
+    g_pipeline = argc > 6 ? atoi(argv[6]) : 1;
+
+    memset(&g_addr, 0, sizeof(g_addr));
+    g_addr.sin_family = AF_INET;
+    g_addr.sin_port = htons(atoi(argv[2]));
+    inet_pton(AF_INET, argv[1], &g_addr.sin_addr);
+    g_request = std::string("GET ") + path + " HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n";
+
+    int epfd = epoll_create1(0);
+    std::vector<Conn> pool(conns);
+    for (auto &c : pool)
+    {
+        if (Connect(epfd, c) < 0)
+        {
+            perror("connect");
+            return 1;
+        }
+        SendBatch(c);
+    }
+
+    std::vector<epoll_event> events(conns);
+    char buf[65536];
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        int n = epoll_wait(epfd, events.data(), conns, 100);
+        for (int i = 0; i < n; i++)
+        {
+            Conn &c = *static_cast<Conn *>(events[i].data.ptr);
+            bool closed = false;
+            while (true)
+            {
+                ssize_t len = recv(c.fd, buf, sizeof(buf), 0);
+                if (len > 0)
+                {
+                    c.in.append(buf, len);
+                    continue;
+                }
+                if (len == 0 || errno != EAGAIN)
+                {
+                    closed = true;
+                }
+                break;
+            }
+            int got = ConsumeResponses(c);
+            g_done += got;
+            c.outstanding -= got;
+            if (closed)
+            {
+                // 服务端关闭了连接(非 keep-alive 或超时)，重连继续压
+                g_errors += c.outstanding;
+                epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+                close(c.fd);
+                if (Connect(epfd, c) < 0)
+                {
+                    continue;
+                }
+                SendBatch(c);
+            }
+            else if (c.outstanding == 0)
+            {
+                SendBatch(c);
+            }
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("conns=%d pipeline=%d seconds=%.2f\n", conns, g_pipeline, elapsed);
+    printf("requests=%ld errors=%ld\n", g_done, g_errors);
+    printf("QPS=%.0f  throughput=%.2f MB/s\n", g_done / elapsed, g_bytes / elapsed / 1024 / 1024);
+
+    for (auto &c : pool)
+    {
+        close(c.fd);
+    }
+    close(epfd);
+    return 0;
+}
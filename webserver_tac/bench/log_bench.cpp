@@ -0,0 +1,152 @@
+// 异步日志微基准：BlockDeque<std::string> vs 无锁环形缓冲 vs 二进制(延迟格式化)
+// 多个线程同时用 LOG_INFO 写日志，统计调用方看到的每秒行数(写线程落盘不计入，和工作线程的视角一致)，
+// 以及调用方线程自己花掉的 CPU 时间(不含被写线程抢走的时间，单核机器上墙钟时间主要是和写线程分时)。
+// Log 是单例，每种配置 fork 一个子进程跑，写到各自的临时目录；子进程退出时写线程落盘完毕，父进程再数一遍行数(二进制模式数数据记录)做校验。
+// 用法: log_bench [每种配置的总行数=200000]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../code/log/log.h"
+
+enum Mode
+{
+    BLOCK,
+    RING,
+    BINARY,
+};
+static const char *MODE_NAMES[] = {"block", "ring", "binary"};
+
+static double ThreadCpuNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void RunChild(const char *dir, Mode mode, int threads, long lines)
+{
+    Log::Instance()->init(1, dir, ".log", 1024, mode != BLOCK, mode == BINARY);
+    long perThread = lines / threads;
+    std::vector<double> cpuNs(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([t, perThread, &cpuNs] {
+            double begin = ThreadCpuNs();
+            for (long i = 0; i < perThread; i++)
+            {
+                LOG_INFO("Client[%d](127.0.0.1:%d) in, request %ld done, userCount:%d", t + 10, 40000 + t, i, 128);
+            }
+            cpuNs[t] = ThreadCpuNs() - begin;
+        });
+    }
+    double cpu = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+        cpu += cpuNs[t];
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-6s threads=%d  %8.0f ns/line  %6.2f M lines/s  %6.0f cpu ns/line\n", MODE_NAMES[mode], threads,
+           sec * 1e9 / (perThread * threads), perThread * threads / sec / 1e6, cpu / (perThread * threads));
+    fflush(stdout);
+}
+
+// 二进制日志里的数据记录数，格式见 binlog.h
+static long CountRecords(FILE *fp)
+{
+    long count = 0;
+    uint32_t head[2];
+    while (fread(head, sizeof(head), 1, fp) == 1 && head[0] >= sizeof(head))
+    {
+        count += head[1] != binlog::DEF_ID;
+        fseek(fp, head[0] - sizeof(head), SEEK_CUR);
+    }
+    return count;
+}
+
+// 数目录下所有日志文件的行数，顺带删掉
+static long CountAndRemove(const char *dir, bool binary)
+{
+    long count = 0;
+    DIR *d = opendir(dir);
+    if (d == nullptr)
+    {
+        return -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr)
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        std::string file = std::string(dir) + "/" + entry->d_name;
+        FILE *fp = fopen(file.c_str(), "r");
+        if (fp != nullptr && binary)
+        {
+            count += CountRecords(fp);
+            fclose(fp);
+        }
+        else if (fp != nullptr)
+        {
+            int c;
+            while ((c = fgetc(fp)) != EOF)
+            {
+                count += c == '\n';
+            }
+            fclose(fp);
+        }
+        unlink(file.c_str());
+    }
+    closedir(d);
+    rmdir(dir);
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    long lines = argc > 1 ? atol(argv[1]) : 200000;
+    const int threadCounts[] = {1, 2, 4, 8};
+    bool ok = true;
+    for (Mode mode : {BLOCK, RING, BINARY})
+    {
+        for (int threads : threadCounts)
+        {
+            char dir[] = "/tmp/log_bench.XXXXXX";
+            if (mkdtemp(dir) == nullptr)
+            {
+                perror("mkdtemp");
+                return 1;
+            }
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                RunChild(dir, mode, threads, lines);
+                exit(0); // 静态 Log 析构时等写线程把剩下的写完
+            }
+            int status = 0;
+            waitpid(pid, &status, 0);
+            long expect = lines / threads * threads;
+            long got = CountAndRemove(dir, mode == BINARY);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || got != expect)
+            {
+                printf("%-6s threads=%d  FAILED: %ld lines written, expected %ld\n", MODE_NAMES[mode], threads, got,
+                       expect);
+                ok = false;
+            }
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+// 关闭的日志有多贵：按 HttpRequest 解析一个 GET 请求时的 LOG_DEBUG 调用(请求行 1 条、每个头部 1 条、解析结果 1 条)，
+// 日志级别设为 info，这些调用都不会输出，比较每个请求花在日志上的时间：
+//   mutex    原来的 LOG_BASE，GetLevel 每次加锁读 level_
+//   atomic   运行时过滤，GetLevel 是一次 relaxed 原子读
+//   compile  LOG_MIN_LEVEL=1，LOG_DEBUG 在编译期去掉
+//   none     没有日志调用，只有测试循环本身的开销
+// 用法: log_off_bench [请求数=5000000]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../code/log/log.h"
+
+struct Request
+{
+    std::string method;
+    std::string path;
+    std::string version;
+    std::vector<std::string> headers;
+};
+
+static std::mutex levelMtx;
+
+// 原来的 GetLevel
+static int LockedLevel()
+{
+    std::lock_guard<std::mutex> locker(levelMtx);
+    return Log::Instance()->GetLevel();
+}
+
+#define MUTEX_LOG_DEBUG(format, ...)                                                                                   \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        Log *log = Log::Instance();                                                                                    \
+        if (log->IsOpen() && LockedLevel() <= 0)                                                                       \
+        {                                                                                                              \
+            log->write(0, format, ##__VA_ARGS__);                                                                      \
+        }                                                                                                              \
+    } while (0);
+
+// 和 HttpRequest::ParseRequestLine_/ParseHeader_/parse 里的调用一致
+#define REQUEST_LOGS(LOGD, req)                                                                                        \
+    LOGD("ParseLine : [%.*s]", (int)(req).path.size(), (req).path.data());                                             \
+    for (const std::string &h : (req).headers)                                                                         \
+    {                                                                                                                  \
+        LOGD("ParseHeader : [%.*s]", (int)h.size(), h.data());                                                         \
+    }                                                                                                                  \
+    LOGD("[%.*s], [%s], [%.*s]", (int)(req).method.size(), (req).method.data(), (req).path.c_str(),                    \
+         (int)(req).version.size(), (req).version.data());
+
+static void LogMutex(const Request &req)
+{
+    REQUEST_LOGS(MUTEX_LOG_DEBUG, req)
+}
+
+static void LogAtomic(const Request &req)
+{
+    REQUEST_LOGS(LOG_DEBUG, req)
+}
+
+// LOG_BASE 展开时才读 LOG_MIN_LEVEL，重新定义后下面的 LOG_DEBUG 就是编译期去掉的版本
+#undef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1
+
+static void LogCompiledOut(const Request &req)
+{
+    REQUEST_LOGS(LOG_DEBUG, req)
+}
+
+static void NoLog(const Request &)
+{
+}
+
+template <class F> static void Run(const char *name, const std::vector<Request> &reqs, long n, int calls, F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++)
+    {
+        f(reqs[i % reqs.size()]);
+        asm volatile("" ::: "memory"); // 防止整个循环被优化掉
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    printf("%-8s %7.2f ns/request  %6.2f ns/call\n", name, ns, ns / calls);
+}
+
+int main(int argc, char *argv[])
+{
+    long n = argc > 1 ? atol(argv[1]) : 5000000;
+
+    char dir[] = "/tmp/log_off_bench.XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    Log::Instance()->init(1, dir, ".log", 0); // info 级别，同步模式；debug 都不输出
+
+    std::vector<Request> reqs;
+    for (int i = 0; i < 16; i++)
+    {
+        Request req = {"GET", "/index" + std::to_string(i) + ".html", "1.1", {}};
+        req.headers = {"Host: 127.0.0.1:8080", "User-Agent: bench", "Accept: */*", "Accept-Encoding: gzip",
+                       "Connection: keep-alive", "Cache-Control: no-cache"};
+        reqs.push_back(req);
+    }
+    int calls = static_cast<int>(reqs[0].headers.size()) + 2;
+
+    printf("%d LOG_DEBUG calls per request, log level info\n", calls);
+    Run("mutex", reqs, n, calls, LogMutex);
+    Run("atomic", reqs, n, calls, LogAtomic);
+    Run("compile", reqs, n, calls, LogCompiledOut);
+    Run("none", reqs, n, calls, NoLog);
+
+    char file[256];
+    time_t timer = time(nullptr);
+    struct tm t;
+    localtime_r(&timer, &t);
+    snprintf(file, sizeof(file), "%s/%04d_%02d_%02d.log", dir, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    unlink(file);
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,166 @@
+// HTTP 请求解析微基准：旧的 "逐行拷贝 + std::regex" 方式 vs 新的增量状态机
+// 另外把请求逐字节喂给新解析器，检查断点续扫的结果与一次性解析一致。
+// 用法: parser_bench [迭代次数=200000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+#include "../code/buffer/buffer.h"
+#include "../code/http/http_request.h"
+
+static const char REQUEST[] = "GET /index.html HTTP/1.1\r\n"
+                              "Host: 127.0.0.1:8080\r\n"
+                              "Connection: keep-alive\r\n"
+                              "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 Chrome/122.0 Safari/537.36\r\n"
+                              "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                              "Accept-Encoding: gzip, deflate, br\r\n"
+                              "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+                              "Cache-Control: max-age=0\r\n"
+                              "\r\n";
+
+// 原来 HttpRequest::parse 的做法，原样搬过来作为对照
+struct RegexParser
+{
+    enum PARSE_STATE
+    {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        FINISH,
+    };
+    PARSE_STATE state_ = REQUEST_LINE;
+    std::string method_, path_, version_, body_;
+    std::unordered_map<std::string, std::string> header_;
+
+    bool ParseRequestLine_(const std::string &line)
+    {
+        std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+        std::smatch subMatch;
+        if (std::regex_match(line, subMatch, patten))
+        {
+            method_ = subMatch[1];
+            path_ = subMatch[2];
+            version_ = subMatch[3];
+            state_ = HEADERS;
+            return true;
+        }
+        return false;
+    }
+
+    void ParseHeader_(const std::string &line)
+    {
+        std::regex patten("^([^:]*): ?(.*)$");
+        std::smatch subMatch;
+        if (std::regex_match(line, subMatch, patten))
+        {
+            header_[subMatch[1]] = subMatch[2];
+        }
+        else
+        {
+            state_ = method_ == "POST" ? BODY : FINISH;
+        }
+    }
+
+    bool parse(Buffer &buff)
+    {
+        const char CRLF[] = "\r\n";
+        method_ = path_ = version_ = body_ = "";
+        state_ = REQUEST_LINE;
+        header_.clear();
+        while (buff.ReadableBytes() && state_ != FINISH)
+        {
+            const char *lineEnd = std::search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
+            std::string line(buff.Peek(), lineEnd);
+            switch (state_)
+            {
+            case REQUEST_LINE:
+                if (!ParseRequestLine_(line))
+                {
+                    return false;
+                }
+                break;
+            case HEADERS:
+                ParseHeader_(line);
+                break;
+            case BODY:
+                body_ = line;
+                state_ = FINISH;
+                break;
+            default:
+                break;
+            }
+            if (lineEnd == buff.BeginWrite())
+            {
+                buff.RetrieveUntil(lineEnd);
+                break;
+            }
+            buff.RetrieveUntil(lineEnd + 2);
+        }
+        return true;
+    }
+};
+
+template <class F> static double Measure(int iters, F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+    {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iters;
+}
+
+int main(int argc, char **argv)
+{
+    int iters = argc > 1 ? atoi(argv[1]) : 200000;
+    const size_t len = sizeof(REQUEST) - 1;
+
+    /* 正确性: 逐字节喂入，只有最后一个字节到达时才应解析完成 */
+    {
+        Buffer buff;
+        HttpRequest request;
+        for (size_t i = 0; i < len; i++)
+        {
+            buff.Append(REQUEST + i, 1);
+            HttpRequest::HTTP_CODE ret = request.parse(buff);
+            if ((i + 1 < len && ret != HttpRequest::NO_REQUEST) || (i + 1 == len && ret != HttpRequest::GET_REQUEST))
+            {
+                printf("incremental parse FAILED at byte %zu\n", i);
+                return 1;
+            }
+        }
+        if (request.path() != "/index.html" || request.method() != "GET" || !request.IsKeepAlive() ||
+            request.GetHeader("accept-encoding") != "gzip, deflate, br" || buff.ReadableBytes() != 0)
+        {
+            printf("incremental parse FAILED: wrong fields\n");
+            return 1;
+        }
+        printf("incremental parse ok\n");
+    }
+
+    Buffer regexBuff;
+    RegexParser regexParser;
+    double regexNs = Measure(iters / 20 + 1, [&] {
+        regexBuff.Append(REQUEST, len);
+        regexParser.parse(regexBuff);
+    });
+
+    Buffer buff;
+    HttpRequest request;
+    double fsmNs = Measure(iters, [&] {
+        buff.Append(REQUEST, len);
+        request.parse(buff);
+    });
+
+    printf("request bytes: %zu\n", len);
+    printf("regex parser : %10.1f ns/request\n", regexNs);
+    printf("state machine: %10.1f ns/request\n", fsmNs);
+    printf("speedup      : %10.1fx\n", regexNs / fsmNs);
+    return 0;
+}
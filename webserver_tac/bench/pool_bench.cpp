@@ -0,0 +1,201 @@
+// 线程池微基准：ThreadPool(单锁单队列) vs WorkStealingPool
+// 模拟反应堆线程：一个线程连续提交任务，任务内空转若干次模拟不同的任务大小，全部完成后统计吞吐。
+// 再测按批提交(AddTasks)、工作线程内部再提交子任务(走本地队列 + 偷取)、按连接亲和分发的情况，并统计提交线程平均每个任务调用 operator new 的次数。
+// 用法: pool_bench [线程数=16] [任务数=1000000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "../code/pool/threadpool.h"
+#include "../code/pool/workstealpool.h"
+
+static thread_local long allocCount = 0; // 本线程调用 operator new 的次数
+
+void *operator new(size_t size)
+{
+    allocCount++;
+    if (void *p = malloc(size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static void Spin(int iters)
+{
+    for (volatile int i = 0; i < iters; i++)
+    {
+    }
+}
+
+static void WaitDone(std::atomic<long> &done, long n)
+{
+    while (done.load(std::memory_order_acquire) < n)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// 外部线程逐个提交 n 个任务
+template <class Pool> static double RunFlat(int threads, long n, int work, double *allocs)
+{
+    Pool pool(threads);
+    std::atomic<long> done(0);
+    long allocBefore = allocCount;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++)
+    {
+        pool.AddTask([&done, work] {
+            Spin(work);
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    *allocs = static_cast<double>(allocCount - allocBefore) / n;
+    WaitDone(done, n);
+    auto end = std::chrono::steady_clock::now();
+    return n / std::chrono::duration<double>(end - start).count();
+}
+
+// 外部线程每攒 BATCH 个任务用 AddTasks 提交一次，模拟一次 epoll_wait 返回多个事件
+template <class Pool> static double RunBatched(int threads, long n, int work)
+{
+    const size_t BATCH = 64;
+    Pool pool(threads);
+    std::atomic<long> done(0);
+    std::vector<Task> batch;
+    batch.reserve(BATCH);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++)
+    {
+        batch.emplace_back([&done, work] {
+            Spin(work);
+            done.fetch_add(1, std::memory_order_release);
+        });
+        if (batch.size() == BATCH)
+        {
+            pool.AddTasks(batch);
+        }
+    }
+    pool.AddTasks(batch);
+    WaitDone(done, n);
+    auto end = std::chrono::steady_clock::now();
+    return n / std::chrono::duration<double>(end - start).count();
+}
+
+// 亲和模式：按连接号(共 conns 个连接)提交，结束后打印各收件箱的最大积压，观察负载是否均衡
+static double RunAffine(int threads, long n, int work, int conns)
+{
+    const size_t BATCH = 64;
+    WorkStealingPool pool(threads, true);
+    std::atomic<long> done(0);
+    std::vector<Task> batch;
+    std::vector<int> keys;
+    batch.reserve(BATCH);
+    keys.reserve(BATCH);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++)
+    {
+        batch.emplace_back([&done, work] {
+            Spin(work);
+            done.fetch_add(1, std::memory_order_release);
+        });
+        keys.push_back(static_cast<int>(i % conns));
+        if (batch.size() == BATCH)
+        {
+            pool.AddTasks(batch, keys);
+        }
+    }
+    pool.AddTasks(batch, keys);
+    WaitDone(done, n);
+    auto end = std::chrono::steady_clock::now();
+    size_t lo = SIZE_MAX, hi = 0;
+    for (size_t i = 0; i < pool.QueueCount(); i++)
+    {
+        lo = std::min(lo, pool.MaxQueueDepth(i));
+        hi = std::max(hi, pool.MaxQueueDepth(i));
+    }
+    printf("%-8s %-8d %14s %16.3f   max depth %zu..%zu over %d conns\n", "affine", work, "-",
+           n / std::chrono::duration<double>(end - start).count() / 1e6, lo, hi, conns);
+    return 0;
+}
+
+// 外部线程提交 n / FAN 个任务，每个任务在工作线程里再提交 FAN - 1 个子任务
+template <class Pool> static double RunNested(int threads, long n, int work)
+{
+    const int FAN = 16;
+    Pool pool(threads);
+    std::atomic<long> done(0);
+    long roots = n / FAN;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < roots; i++)
+    {
+        pool.AddTask([&pool, &done, work] {
+            for (int k = 1; k < FAN; k++)
+            {
+                pool.AddTask([&done, work] {
+                    Spin(work);
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+            Spin(work);
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    WaitDone(done, roots * FAN);
+    auto end = std::chrono::steady_clock::now();
+    return roots * FAN / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 16;
+    long n = argc > 2 ? atol(argv[2]) : 1000000;
+    const int works[] = {0, 100, 1000, 10000};
+
+    printf("threads: %d, tasks: %ld (Mtasks/s)\n", threads, n);
+    printf("%-8s %-8s %14s %16s   %s\n", "mode", "spin", "ThreadPool", "WorkStealingPool", "new/task");
+    for (int work : works)
+    {
+        long cnt = work >= 10000 ? n / 10 : n;
+        double allocA, allocB;
+        double a = RunFlat<ThreadPool>(threads, cnt, work, &allocA);
+        double b = RunFlat<WorkStealingPool>(threads, cnt, work, &allocB);
+        printf("%-8s %-8d %14.3f %16.3f   %.3f / %.3f\n", "flat", work, a / 1e6, b / 1e6, allocA, allocB);
+    }
+    for (int work : works)
+    {
+        long cnt = work >= 10000 ? n / 10 : n;
+        double a = RunBatched<ThreadPool>(threads, cnt, work);
+        double b = RunBatched<WorkStealingPool>(threads, cnt, work);
+        printf("%-8s %-8d %14.3f %16.3f\n", "batch64", work, a / 1e6, b / 1e6);
+    }
+    for (int work : works)
+    {
+        long cnt = work >= 10000 ? n / 10 : n;
+        double a = RunNested<ThreadPool>(threads, cnt, work);
+        double b = RunNested<WorkStealingPool>(threads, cnt, work);
+        printf("%-8s %-8d %14.3f %16.3f\n", "nested", work, a / 1e6, b / 1e6);
+    }
+    for (int work : works)
+    {
+        long cnt = work >= 10000 ? n / 10 : n;
+        RunAffine(threads, cnt, work, 1000);
+    }
+    return 0;
+}
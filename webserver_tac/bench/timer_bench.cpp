@@ -0,0 +1,137 @@
+// 连接超时定时器微基准：HeapTimer vs TimeWheel
+// 模拟大量 keep-alive 连接：先 add N 个定时器，然后按随机顺序反复 adjust(每次 I/O 事件都会做一次)，
+// 其间定期调用 GetNextTick，最后用 doWork 全部删除。另外先用一批短超时检查两者的到期行为一致。
+// 用法: timer_bench [定时器个数=100000] [adjust 轮数=10]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../code/timer/heaptimer.h"
+#include "../code/timer/timewheel.h"
+
+static const int TIMEOUT_MS = 60000;
+
+template <class F> static double Measure(long ops, F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+// 短超时的定时器都应按时触发：不早于到期时间，也不应晚太多
+template <class Timer> static bool CheckExpiry(const char *name)
+{
+    const int n = 2000;
+    Timer timer;
+    std::mt19937 rng(1);
+    std::vector<TimeStamp> due(n), fired(n);
+    int left = n;
+    for (int i = 0; i < n; i++)
+    {
+        int timeout = rng() % 600; // 跨过第 0 层，走一次 cascade
+        due[i] = Clock::now() + MS(timeout);
+        timer.add(i, timeout, [&, i] {
+            fired[i] = Clock::now();
+            left--;
+        });
+    }
+    /* 一部分推迟，一部分提前触发 */
+    for (int i = 0; i < n; i += 7)
+    {
+        due[i] = Clock::now() + MS(300);
+        timer.adjust(i, 300);
+    }
+    for (int i = 3; i < n; i += 11)
+    {
+        timer.doWork(i);
+        due[i] = fired[i];
+    }
+    while (left > 0)
+    {
+        int ms = timer.GetNextTick();
+        if (ms > 0)
+        {
+            std::this_thread::sleep_for(MS(std::min(ms, 5)));
+        }
+    }
+    double maxLate = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double late = std::chrono::duration<double, std::milli>(fired[i] - due[i]).count();
+        if (late < -1.0)
+        {
+            printf("%-10s expiry FAILED: timer %d fired %.2f ms early\n", name, i, -late);
+            return false;
+        }
+        maxLate = std::max(maxLate, late);
+    }
+    printf("%-10s expiry ok, max lateness %.2f ms\n", name, maxLate);
+    return true;
+}
+
+template <class Timer> static void Run(const char *name, int n, int rounds)
+{
+    Timer timer;
+    std::mt19937 rng(42);
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = i;
+    }
+    long fired = 0;
+
+    double addNs = Measure(n, [&] {
+        for (int i = 0; i < n; i++)
+        {
+            timer.add(i, TIMEOUT_MS / 2 + rng() % (TIMEOUT_MS / 2), [&fired] { fired++; });
+        }
+    });
+
+    std::shuffle(order.begin(), order.end(), rng);
+    long adjusts = static_cast<long>(n) * rounds;
+    double adjustNs = Measure(adjusts, [&] {
+        for (int r = 0; r < rounds; r++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                timer.adjust(order[i], TIMEOUT_MS);
+                if ((i & 63) == 0)
+                {
+                    timer.GetNextTick(); // 事件循环每轮 epoll_wait 前都会取一次
+                }
+            }
+        }
+    });
+
+    std::shuffle(order.begin(), order.end(), rng);
+    double delNs = Measure(n, [&] {
+        for (int i = 0; i < n; i++)
+        {
+            timer.doWork(order[i]);
+        }
+    });
+
+    printf("%-10s add %8.1f ns   adjust %8.1f ns   doWork %8.1f ns   (fired %ld)\n", name, addNs, adjustNs, delNs,
+           fired);
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+    if (!CheckExpiry<HeapTimer>("HeapTimer") || !CheckExpiry<TimeWheel>("TimeWheel"))
+    {
+        return 1;
+    }
+    printf("timers: %d, adjust rounds: %d, timeout: %d ms\n", n, rounds, TIMEOUT_MS);
+    Run<HeapTimer>("HeapTimer", n, rounds);
+    Run<TimeWheel>("TimeWheel", n, rounds);
+    return 0;
+}
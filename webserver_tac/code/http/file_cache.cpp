@@ -0,0 +1,110 @@
+#include "file_cache.h"
+
+using namespace std;
+
+FileCache::File::~File()
+{
+    if (data)
+    {
+        munmap(data, st.st_size);
+    }
+}
+
+FileCache::FileCache() : entries_(64 * 1024 * 1024), maxFileBytes_(4 * 1024 * 1024)
+{
+}
+
+FileCache *FileCache::Instance()
+{
+    static FileCache cache;
+    return &cache;
+}
+
+void FileCache::SetCapacity(size_t maxBytes, size_t maxFileBytes)
+{
+    lock_guard<mutex> locker(mtx_);
+    maxFileBytes_ = maxFileBytes;
+    entries_.SetCapacity(maxBytes);
+}
+
+FileCache::FilePtr FileCache::Acquire(const string &path, size_t mapLimit)
+{
+    Clock::time_point now = Clock::now();
+    {
+        // 命中且最近校验过，不做任何系统调用
+        lock_guard<mutex> locker(mtx_);
+        Entry *entry = entries_.Find(path);
+        if (entry && now - entry->checked < chrono::milliseconds(CHECK_INTERVAL_MS))
+        {
+            return entry->file;
+        }
+    }
+
+    struct stat st;
+    if (stat(path.data(), &st) < 0)
+    {
+        lock_guard<mutex> locker(mtx_);
+        entries_.Erase(path);
+        return nullptr;
+    }
+
+    {
+        // 文件没变，刷新校验时间即可
+        lock_guard<mutex> locker(mtx_);
+        Entry *entry = entries_.Find(path);
+        if (entry)
+        {
+            if (SameFile(entry->file->st, st))
+            {
+                entry->checked = now;
+                return entry->file;
+            }
+            entries_.Erase(path);
+        }
+    }
+
+    // 映射放在锁外，避免大文件的 open/mmap 阻塞其他线程
+    FilePtr file = Map_(path, st, static_cast<size_t>(st.st_size) <= mapLimit);
+    if (!file->data || static_cast<size_t>(st.st_size) > maxFileBytes_)
+    {
+        return file;
+    }
+
+    lock_guard<mutex> locker(mtx_);
+    entries_.Put(path, {file, now}, st.st_size); // 并发 miss 时以后映射的为准
+    return file;
+}
+
+void FileCache::Clear()
+{
+    lock_guard<mutex> locker(mtx_);
+    entries_.Clear();
+}
+
+FileCache::FilePtr FileCache::Map_(const string &path, const struct stat &st, bool map)
+{
+    shared_ptr<File> file = make_shared<File>();
+    file->st = st;
+    if (!map || !S_ISREG(st.st_mode) || !(st.st_mode & S_IROTH) || st.st_size == 0)
+    {
+        return file;
+    }
+    int srcFd = open(path.data(), O_RDONLY);
+    if (srcFd < 0)
+    {
+        return file;
+    }
+    void *mmRet = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+    close(srcFd);
+    if (mmRet != MAP_FAILED)
+    {
+        file->data = static_cast<char *>(mmRet);
+    }
+    return file;
+}
+
+bool FileCache::SameFile(const struct stat &a, const struct stat &b)
+{
+    return a.st_ino == b.st_ino && a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+           a.st_mtim.tv_nsec == b.st_mtim.tv_nsec && a.st_mode == b.st_mode;
+}
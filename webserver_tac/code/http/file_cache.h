@@ -0,0 +1,67 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <chrono>
+#include <cstdint> // SIZE_MAX
+#include <fcntl.h> // open
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // stat
+#include <unistd.h>   // close
+
+#include "lru_cache.h"
+
+// 静态文件映射缓存，所有连接共享
+// 同一个文件只 open + mmap 一次，响应通过 shared_ptr 引用映射，最后一个引用释放时才 munmap；
+// 每隔 CHECK_INTERVAL_MS 用 stat 检查一次 mtime/size，文件变了就重新映射；
+// 缓存总字节数超过预算时按 LRU 淘汰，被淘汰的映射在仍被响应引用期间依然有效。
+class FileCache
+{
+  public:
+    struct File
+    {
+        File() : data(nullptr), st{} {}
+        ~File();
+
+        char *data;      // 只读私有映射，非常规文件、不可读、空文件或映射失败时为 nullptr
+        struct stat st;
+    };
+    typedef std::shared_ptr<const File> FilePtr;
+
+    static FileCache *Instance();
+
+    // maxBytes: 缓存的字节预算；maxFileBytes: 超过该大小的文件照常映射但不进缓存
+    void SetCapacity(size_t maxBytes, size_t maxFileBytes);
+
+    // stat 失败(文件不存在)返回 nullptr，否则返回文件信息，能映射的常规文件附带映射；
+    // 大于 mapLimit 的文件只返回 stat 信息，不映射也不缓存(交给 sendfile 发送)
+    FilePtr Acquire(const std::string &path, size_t mapLimit = SIZE_MAX);
+
+    void Clear();
+
+    static bool SameFile(const struct stat &a, const struct stat &b); // inode、大小、mtime、权限都相同
+
+  private:
+    FileCache();
+    ~FileCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        FilePtr file;
+        Clock::time_point checked; // 上次 stat 校验的时间
+    };
+
+    static FilePtr Map_(const std::string &path, const struct stat &st, bool map);
+
+    static constexpr int CHECK_INTERVAL_MS = 1000;
+
+    std::mutex mtx_;
+    LruCache<Entry> entries_; // 以文件大小计入预算
+    size_t maxFileBytes_;
+};
+
+#endif // FILE_CACHE_H
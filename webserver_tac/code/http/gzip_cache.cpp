@@ -0,0 +1,113 @@
+#include "gzip_cache.h"
+
+using namespace std;
+
+GzipCache::GzipCache() : entries_(16 * 1024 * 1024), maxFileBytes_(1024 * 1024)
+{
+}
+
+GzipCache *GzipCache::Instance()
+{
+    static GzipCache cache;
+    return &cache;
+}
+
+void GzipCache::SetCapacity(size_t maxBytes, size_t maxFileBytes)
+{
+    lock_guard<mutex> locker(mtx_);
+    maxFileBytes_ = maxFileBytes;
+    entries_.SetCapacity(maxBytes);
+}
+
+bool GzipCache::Acquire(const string &path, const FileCache::FilePtr &file, DataPtr *data)
+{
+    data->reset();
+    size_t size = file->st.st_size;
+    if (size < MIN_FILE_BYTES)
+    {
+        return false;
+    }
+
+    Clock::time_point now = Clock::now();
+    DataPtr gz;
+    bool compressed = false; // 这个版本是否已经尝试过现场压缩
+    size_t maxFileBytes;
+    {
+        lock_guard<mutex> locker(mtx_);
+        Entry *entry = entries_.Find(path);
+        if (entry && FileCache::SameFile(entry->st, file->st))
+        {
+            // 命中且最近检查过 .gz，不做任何系统调用
+            if (now - entry->checked < chrono::milliseconds(CHECK_INTERVAL_MS))
+            {
+                *data = entry->data;
+                return entry->hasStatic;
+            }
+            gz = entry->data;
+            compressed = !entry->hasStatic;
+        }
+        maxFileBytes = maxFileBytes_;
+    }
+
+    bool hasStatic = HasStatic_(path, file->st);
+    if (!hasStatic && !compressed && file->data && size <= maxFileBytes)
+    {
+        // 压缩放在锁外，并发 miss 时可能重复压缩，以后完成的为准
+        gz = Compress(file->data, size);
+        if (gz && gz->size() >= size)
+        {
+            gz.reset();
+        }
+    }
+    if (hasStatic)
+    {
+        gz.reset();
+    }
+
+    lock_guard<mutex> locker(mtx_);
+    entries_.Put(path, {file->st, hasStatic, gz, now}, gz ? gz->size() : 0);
+    *data = gz;
+    return hasStatic;
+}
+
+void GzipCache::Clear()
+{
+    lock_guard<mutex> locker(mtx_);
+    entries_.Clear();
+}
+
+// 生成带 gzip 头的 deflate 流，失败返回空
+GzipCache::DataPtr GzipCache::Compress(const char *src, size_t len, int level)
+{
+    z_stream zs = {};
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return nullptr;
+    }
+    shared_ptr<string> out = make_shared<string>();
+    out->resize(deflateBound(&zs, len));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src));
+    zs.avail_in = len;
+    zs.next_out = reinterpret_cast<Bytef *>(&(*out)[0]);
+    zs.avail_out = out->size();
+    int ret = deflate(&zs, Z_FINISH);
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END)
+    {
+        return nullptr;
+    }
+    out->resize(zs.total_out);
+    out->shrink_to_fit();
+    return out;
+}
+
+// 预压缩文件须是可读的常规文件，且不比源文件旧
+bool GzipCache::HasStatic_(const string &path, const struct stat &st)
+{
+    struct stat gzSt;
+    if (stat((path + ".gz").data(), &gzSt) < 0)
+    {
+        return false;
+    }
+    return S_ISREG(gzSt.st_mode) && (gzSt.st_mode & S_IROTH) && gzSt.st_mtime >= st.st_mtime;
+}
@@ -0,0 +1,60 @@
+#ifndef GZIP_CACHE_H
+#define GZIP_CACHE_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h> // stat
+#include <zlib.h>     // deflate
+
+#include "file_cache.h"
+#include "lru_cache.h"
+
+// 文本资源的 gzip 版本缓存，所有连接共享
+// 每个路径记录两件事：是否存在可用的 .gz 兄弟文件(预压缩)，以及没有时现场压缩出的内容；
+// 条目以源文件的 stat 为版本，源文件变了就作废；.gz 是否存在每隔 CHECK_INTERVAL_MS 才重新 stat 一次。
+// 现场压缩的结果按字节预算 LRU 淘汰，压缩后不变小的文件只记一个空条目，避免反复压缩。
+class GzipCache
+{
+  public:
+    typedef std::shared_ptr<const std::string> DataPtr;
+
+    static GzipCache *Instance();
+
+    // maxBytes: 压缩结果的字节预算；maxFileBytes: 超过该大小的源文件不做现场压缩
+    void SetCapacity(size_t maxBytes, size_t maxFileBytes);
+
+    // file 是 FileCache 给出的源文件。存在比源文件新的 .gz 兄弟文件时返回 true；
+    // 否则 *data 带回现场压缩的内容，不适合压缩时为空
+    bool Acquire(const std::string &path, const FileCache::FilePtr &file, DataPtr *data);
+
+    void Clear();
+
+    static DataPtr Compress(const char *src, size_t len, int level = Z_DEFAULT_COMPRESSION);
+
+  private:
+    GzipCache();
+    ~GzipCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        struct stat st; // 源文件版本
+        bool hasStatic;
+        DataPtr data;
+        Clock::time_point checked; // 上次检查 .gz 的时间
+    };
+
+    static bool HasStatic_(const std::string &path, const struct stat &st);
+
+    static constexpr int CHECK_INTERVAL_MS = 1000;
+    static const size_t MIN_FILE_BYTES = 256; // 太小的文件压缩不划算
+
+    std::mutex mtx_;
+    LruCache<Entry> entries_; // 以压缩结果的大小计入预算
+    size_t maxFileBytes_;
+};
+
+#endif // GZIP_CACHE_H
@@ -6,7 +6,11 @@ const char *HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
 
-HttpConn::HttpConn() : fd_(-1), addr_({0}), isClose_(true){};
+HttpConn::HttpConn() : fd_(-1), addr_({0}), isClose_(true), keepAlive_(false), verifyPending_(false), lastActive_(0), iovIdx_(0), toWrite_(0), respCnt_(0)
+{
+    iov_.reserve(MAX_PIPELINE * 2);
+    fileSegs_.reserve(MAX_PIPELINE * 2);
+};
 
 HttpConn::~HttpConn()
 {
@@ -21,12 +25,22 @@ void HttpConn::init(int fd, const sockaddr_in &addr)
     fd_ = fd;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    request_.Init();
+    iov_.clear();
+    fileSegs_.clear();
+    iovIdx_ = toWrite_ = 0;
+    keepAlive_ = false;
+    verifyPending_ = false;
     isClose_ = false;
 }
 
 void HttpConn::Close()
 {
-    response_.UnmapFile();
+    for (int i = 0; i < respCnt_; i++)
+    {
+        responses_[i].UnmapFile();
+    }
+    respCnt_ = 0;
     if (!isClose_)
     {
         isClose_ = true;
@@ -74,64 +88,183 @@ ssize_t HttpConn::write(int *saveErrno)
     ssize_t len = -1;
     do
     {
-        if (iov_[0].iov_len + iov_[1].iov_len == 0)
+        if (toWrite_ == 0)
         {
             break;
-        } /* 传输结束 */   //mark一下，这里被我移动了位置。
-        len = writev(fd_, iov_, iovCnt_);
-        if (len <= 0)
+        } /* 传输结束 */
+        FileSeg &seg = fileSegs_[iovIdx_];
+        if (seg.fd >= 0)
         {
-            *saveErrno = errno;
-            break;
+            /* 大文件段: 内核直接从页缓存拷到 socket，offset 由 sendfile 推进，EAGAIN 后从这里继续 */
+            len = sendfile(fd_, seg.fd, &seg.offset, iov_[iovIdx_].iov_len);
+            if (len == 0)
+            {
+                /* 文件在 stat 之后被截断，提前读到 EOF: 再等可写事件也发不出去，当作出错关闭连接 */
+                *saveErrno = EIO;
+                len = -1;
+                break;
+            }
         }
-        else if (static_cast<size_t>(len) > iov_[0].iov_len)
+        else
         {
-            iov_[1].iov_base = (uint8_t *)iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if (iov_[0].iov_len)
+            /* 连续的内存段(响应头、mmap 的小文件)合并成一次 writev */
+            size_t end = iovIdx_ + 1;
+            while (end < iov_.size() && fileSegs_[end].fd < 0)
             {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
+                end++;
             }
+            len = writev(fd_, &iov_[iovIdx_], static_cast<int>(end - iovIdx_));
         }
-        else
+        if (len <= 0)
+        {
+            *saveErrno = errno;
+            break;
+        }
+        Advance_(static_cast<size_t>(len));
+        if (toWrite_ == 0)
         {
-            iov_[0].iov_base = (uint8_t *)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            writeBuff_.Retrieve(len);
+            writeBuff_.RetrieveAll();
         }
     } while (isET || ToWriteBytes() > 10240);
     return len;
 }
 
-bool HttpConn::process()
+/* 跳过已经写完的段，写了一半的那个调整起点 */
+void HttpConn::Advance_(size_t len)
 {
-    request_.Init();
-    if (readBuff_.ReadableBytes() <= 0)
+    toWrite_ -= len;
+    while (len > 0)
     {
-        return false;
+        struct iovec &iov = iov_[iovIdx_];
+        if (len >= iov.iov_len)
+        {
+            len -= iov.iov_len;
+            iov.iov_len = 0;
+            iovIdx_++;
+        }
+        else
+        {
+            if (fileSegs_[iovIdx_].fd < 0)
+            {
+                iov.iov_base = (uint8_t *)iov.iov_base + len;
+            }
+            iov.iov_len -= len;
+            len = 0;
+        }
     }
-    else if (request_.parse(readBuff_))
+}
+
+// 把读缓冲区里所有完整的请求都解析掉(HTTP 流水线)，响应按顺序排进同一批 iovec，一次 writev 发出。
+// deferVerify 为 true 时遇到要查数据库的登录/注册请求就先返回 false 并置 VerifyPending()，
+// 由调用方换到别的线程再调一次 process，从这个请求接着处理
+bool HttpConn::process(bool deferVerify)
+{
+    if (!verifyPending_)
     {
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+        for (int i = 0; i < respCnt_; i++)
+        {
+            responses_[i].UnmapFile(); // 释放上一批的文件映射
+        }
+        respCnt_ = 0;
     }
-    else
+
+    while (respCnt_ < MAX_PIPELINE)
     {
-        response_.Init(srcDir, request_.path(), false, 400);
+        HttpRequest::HTTP_CODE ret;
+        if (verifyPending_)
+        {
+            // 上次停在这个请求的校验上
+            verifyPending_ = false;
+            request_.Verify();
+            ret = HttpRequest::GET_REQUEST;
+        }
+        else
+        {
+            if (readBuff_.ReadableBytes() == 0)
+            {
+                break;
+            }
+            ret = request_.parse(readBuff_);
+            if (ret == HttpRequest::NO_REQUEST)
+            {
+                break; // 剩下的请求还不完整，继续等待数据，解析进度保存在 request_ 里
+            }
+            if (ret == HttpRequest::GET_REQUEST && request_.NeedVerify())
+            {
+                if (deferVerify)
+                {
+                    verifyPending_ = true;
+                    return false;
+                }
+                request_.Verify();
+            }
+        }
+        if (respCnt_ == static_cast<int>(responses_.size()))
+        {
+            responses_.emplace_back();
+        }
+        HttpResponse &response = responses_[respCnt_];
+        keepAlive_ = (ret == HttpRequest::GET_REQUEST) && request_.IsKeepAlive();
+        if (ret == HttpRequest::GET_REQUEST)
+        {
+            response.Init(srcDir, request_.path(), keepAlive_, 200);
+        }
+        else
+        {
+            response.Init(srcDir, request_.path(), false, 400);
+        }
+        HttpResponse::RequestInfo info;
+        if (ret == HttpRequest::GET_REQUEST && request_.method() == "GET")
+        {
+            info.range = request_.GetHeader("Range");
+            info.ifRange = request_.GetHeader("If-Range");
+            info.ifNoneMatch = request_.GetHeader("If-None-Match");
+            info.ifModifiedSince = request_.GetHeader("If-Modified-Since");
+            info.acceptEncoding = request_.GetHeader("Accept-Encoding");
+        }
+        headOff_[respCnt_] = writeBuff_.ReadableBytes();
+        response.MakeResponse(writeBuff_, info);
+        respCnt_++;
+        if (!keepAlive_)
+        {
+            break; // 连接发完就要关闭，后面的请求不再处理
+        }
+    }
+    if (respCnt_ == 0)
+    {
+        return false;
     }
 
-    response_.MakeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char *>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;
-
-    /* 文件 */
-    if (response_.FileLen() > 0 && response_.File())
+    /* 所有响应头都写完之后 writeBuff_ 不会再扩容，这时再取指针 */
+    iov_.clear();
+    fileSegs_.clear();
+    iovIdx_ = 0;
+    toWrite_ = 0;
+    for (int i = 0; i < respCnt_; i++)
     {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
+        HttpResponse &response = responses_[i];
+        for (const HttpResponse::Segment &seg : response.Segments())
+        {
+            if (!seg.inFile)
+            {
+                /* 响应头(以及 multipart 的段头) */
+                iov_.push_back({const_cast<char *>(writeBuff_.Peek()) + headOff_[i] + seg.off, seg.len});
+                fileSegs_.push_back({-1, 0});
+            }
+            else if (response.File())
+            {
+                /* 小文件: mmap 的内存 */
+                iov_.push_back({response.File() + seg.off, seg.len});
+                fileSegs_.push_back({-1, 0});
+            }
+            else
+            {
+                /* 大文件: 交给 sendfile 的 fd */
+                iov_.push_back({nullptr, seg.len});
+                fileSegs_.push_back({response.FileFd(), static_cast<off_t>(seg.off)});
+            }
+            toWrite_ += seg.len;
+        }
     }
     return true;
-}
\ No newline at end of file
+}
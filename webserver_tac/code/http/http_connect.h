@@ -3,9 +3,12 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/sendfile.h> // sendfile
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>      
+#include <deque>
+#include <vector>
 
 #include "../buffer/buffer.h"
 #include "http_request.h"
@@ -33,14 +36,29 @@ public:
     
     sockaddr_in GetAddr() const;
     
-    bool process();
+    bool process(bool deferVerify = false);
 
-    int ToWriteBytes() { 
-        return iov_[0].iov_len + iov_[1].iov_len; 
+    // process 停在了一个待校验的登录/注册请求上，需要再调一次 process 接着处理
+    bool VerifyPending() const {
+        return verifyPending_;
     }
 
+    size_t ToWriteBytes() const { 
+        return toWrite_; 
+    }
+
+    // 本批最后一个请求是否 keep-alive；request_ 此时可能已经在解析下一个不完整的请求了
     bool IsKeepAlive() const {
-        return request_.IsKeepAlive();
+        return keepAlive_;
+    }
+
+    // 惰性超时模式下，I/O 事件只记录最近一次活跃的时间(毫秒)，由定时扫描决定是否关闭
+    void SetActive(int64_t ms) {
+        lastActive_ = ms;
+    }
+
+    int64_t LastActive() const {
+        return lastActive_;
     }
 
     static bool isET;
@@ -53,15 +71,33 @@ private:
     struct sockaddr_in addr_;
 
     bool isClose_;
-    
-    int iovCnt_;
-    struct iovec iov_[2];
+    bool keepAlive_;
+    bool verifyPending_;
+    int64_t lastActive_;
+
+    static const int MAX_PIPELINE = 16; // 一次 process 最多处理的流水线请求数
+
+    // 走 sendfile 的文件段，与 iov_ 一一对应，fd < 0 表示该段在内存里
+    struct FileSeg
+    {
+        int fd;
+        off_t offset;
+    };
+
+    void Advance_(size_t len); // 已经发出 len 字节，推进 iov_ 和 fileSegs_
+
+    std::vector<struct iovec> iov_; // 响应头与文件交替排列，连续的内存段一次 writev 发出
+    std::vector<FileSeg> fileSegs_;
+    size_t iovIdx_;                 // 第一个还没写完的 iovec
+    size_t toWrite_;                // 剩余待写字节数
     
     Buffer readBuff_; // 读缓冲区
-    Buffer writeBuff_; // 写缓冲区
+    Buffer writeBuff_; // 写缓冲区，存放本批所有响应头
 
     HttpRequest request_;
-    HttpResponse response_;
+    std::deque<HttpResponse> responses_; // 本批响应，按请求顺序，deque 扩容时不会搬动已有元素
+    int respCnt_;
+    size_t headOff_[MAX_PIPELINE]; // 本批各响应头在 writeBuff_ 中的偏移
 };
 
 
@@ -17,125 +17,203 @@ const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG{
 
 void HttpRequest::Init()
 {
-    method_ = path_ = version_ = body_ = "";
+    path_ = body_ = "";
+    method_ = version_ = string_view();
     state_ = REQUEST_LINE;
+    checked_ = lineStart_ = bodyStart_ = contentLen_ = 0;
+    keepAlive_ = false;
+    verifyTag_ = -1;
+    methodSpan_ = pathSpan_ = versionSpan_ = {0, 0};
+    headerSpans_.clear();
     header_.clear();
     post_.clear();
 }
 
-bool HttpRequest::parse(Buffer &buff)
+// 手写状态机，直接在 buff.Peek() 上扫描，不再逐行拷贝成 string 再用 regex 匹配。
+// 各字段先以相对于请求起点的偏移记录下来，读到不完整的数据就返回 NO_REQUEST，
+// 下次调用时从 checked_ 处继续，不会重复扫描已经看过的字节。
+HttpRequest::HTTP_CODE HttpRequest::parse(Buffer &buff)
 {
-    const char CRLF[] = "\r\n"; // 行结束符标志(回车换行)
-    if (buff.ReadableBytes() <= 0)
+    if (state_ == FINISH)
     {
-        return false;
+        Init(); // 上一个请求已经处理完，开始解析下一个
     }
-    while (buff.ReadableBytes() && state_ != FINISH)
+    const char *begin = buff.Peek();
+    const size_t readable = buff.ReadableBytes();
+
+    while (state_ == REQUEST_LINE || state_ == HEADERS)
     {
-        // 从buff中的读指针开始到写指针开始对应区域是未读取的数据
-        // 1.如果这块数据中找到以"\r\n"开头的内容，返回"\r\n"开头的位置，这就是对应有效数据的结尾+1
-        // 那么[buff.Peek(),lineEnd)是有效数据,清空数据时buff.RetrieveUntil(lineEnd + 2)
-        // 2.当找不到的时候，返回的是buff.BeginWrite()，那么[buff.Peek(),lineEnd)仍然是有效数据
-        // 只是说buff已经到结尾了，这时候buff.RetrieveUntil(lineEnd)就行了，不然会报错。
-        const char *lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        std::string line(buff.Peek(), lineEnd); // 有效数据
-        switch (state_)
+        const char *lineEnd = static_cast<const char *>(memchr(begin + checked_, '\n', readable - checked_));
+        if (lineEnd == nullptr)
         {
-        case REQUEST_LINE:
-            if (!ParseRequestLine_(line)) // 先解析行，转换状态
+            checked_ = readable;
+            if (readable > MAX_HEADER_LEN)
             {
-                return false;
+                LOG_ERROR("Request header too long");
+                buff.Retrieve(readable);
+                state_ = FINISH;
+                return BAD_REQUEST;
             }
-            ParsePath_(); // 定位到资源
-            break;
-        case HEADERS:
-            ParseHeader_(line); // 解析报头，直到遇到空行
-            break;
-        case BODY:
-            ParseBody_(line); // 解析正文段,首先判断是不是post，不然直接结束
-            break;
-        default:
-            break;
+            return NO_REQUEST;
         }
-        if (lineEnd == buff.BeginWrite())
+        size_t next = lineEnd - begin + 1;
+        size_t end = next - 1;
+        if (end > lineStart_ && begin[end - 1] == '\r')
         {
-            // 这种情况是对于post请求，其报文段是没有回车的
-            buff.RetrieveUntil(lineEnd);
-            break;
+            end--; // 去掉 "\r\n" 中的 '\r'
+        }
+
+        bool ok = (state_ == REQUEST_LINE) ? ParseRequestLine_(begin, lineStart_, end)
+                                           : ParseHeader_(begin, lineStart_, end);
+        if (!ok)
+        {
+            buff.Retrieve(readable);
+            state_ = FINISH;
+            return BAD_REQUEST;
         }
-        // 把这行数据包括/r/n给取出来
-        buff.RetrieveUntil(lineEnd + 2);
+        checked_ = lineStart_ = next;
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
-    return true;
+
+    if (state_ == BODY)
+    {
+        if (readable - bodyStart_ < contentLen_)
+        {
+            checked_ = readable;
+            return NO_REQUEST;
+        }
+        body_.assign(begin + bodyStart_, contentLen_);
+    }
+
+    Finish_(begin);
+    // 只移动读下标，数据仍留在缓冲区里，method/version/header 视图在下次读 socket 前都有效
+    buff.Retrieve(bodyStart_ + contentLen_);
+    state_ = FINISH;
+    ParsePath_();
+    ParsePost_();
+    LOG_DEBUG("[%.*s], [%s], [%.*s]", (int)method_.size(), method_.data(), path_.c_str(), (int)version_.size(),
+              version_.data());
+    return GET_REQUEST;
 }
 
-void HttpRequest::ParsePath_()
+// 请求行：METHOD SP URL SP HTTP/VERSION
+bool HttpRequest::ParseRequestLine_(const char *begin, size_t lineStart, size_t lineEnd)
 {
-    if (path_ == "/")
+    const char *line = begin + lineStart;
+    size_t len = lineEnd - lineStart;
+    LOG_DEBUG("ParseLine : [%.*s]", (int)len, line);
+
+    const char *sp1 = static_cast<const char *>(memchr(line, ' ', len));
+    if (sp1 == nullptr || sp1 == line)
     {
-        path_ = "/index.html";
+        LOG_ERROR("RequestLine Error");
+        return false;
     }
-    else
+    const char *rest = sp1 + 1;
+    const char *sp2 = static_cast<const char *>(memchr(rest, ' ', line + len - rest));
+    if (sp2 == nullptr || sp2 == rest)
     {
-        for (auto &item : DEFAULT_HTML)
-        {
-            if (item == path_)
-            {
-                path_ += ".html";
-                break;
-            }
-        }
+        LOG_ERROR("RequestLine Error");
+        return false;
+    }
+    const char *ver = sp2 + 1;
+    size_t verLen = line + len - ver;
+    if (verLen <= 5 || memcmp(ver, "HTTP/", 5) != 0 || memchr(ver, ' ', verLen) != nullptr)
+    {
+        LOG_ERROR("RequestLine Error");
+        return false;
     }
+
+    methodSpan_ = {lineStart, static_cast<size_t>(sp1 - line)};
+    pathSpan_ = {static_cast<size_t>(rest - begin), static_cast<size_t>(sp2 - rest)};
+    versionSpan_ = {static_cast<size_t>(ver - begin) + 5, verLen - 5};
+    state_ = HEADERS;
+    return true;
 }
 
-bool HttpRequest::ParseRequestLine_(const string &line)
+// 请求头：KEY: VALUE，遇到空行进入请求体或结束
+bool HttpRequest::ParseHeader_(const char *begin, size_t lineStart, size_t lineEnd)
 {
-    LOG_DEBUG("ParseLine : [%s]", line.c_str()); // 打印出来
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten))
+    if (lineStart == lineEnd)
     {
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
+        bodyStart_ = lineEnd + (begin[lineEnd] == '\r' ? 2 : 1);
+        state_ = contentLen_ > 0 ? BODY : FINISH;
         return true;
     }
-    LOG_ERROR("RequestLine Error");
-    return false;
-}
+    const char *line = begin + lineStart;
+    size_t len = lineEnd - lineStart;
+    LOG_DEBUG("ParseHeader : [%.*s]", (int)len, line);
 
-void HttpRequest::ParseHeader_(const string &line)
-{
-    LOG_DEBUG("ParseHeader : [%s]", line.c_str()); // 打印出来
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten))
+    const char *colon = static_cast<const char *>(memchr(line, ':', len));
+    if (colon == nullptr || colon == line)
     {
-        header_[subMatch[1]] = subMatch[2];
+        LOG_ERROR("Header Error");
+        return false;
     }
-    else
+    size_t keyLen = colon - line;
+    size_t valOff = keyLen + 1;
+    while (valOff < len && (line[valOff] == ' ' || line[valOff] == '\t'))
+    {
+        valOff++;
+    }
+    size_t valEnd = len;
+    while (valEnd > valOff && (line[valEnd - 1] == ' ' || line[valEnd - 1] == '\t'))
+    {
+        valEnd--;
+    }
+    HeaderSpan header = {{lineStart, keyLen}, {lineStart + valOff, valEnd - valOff}};
+    headerSpans_.push_back(header);
+
+    string_view key(line, keyLen);
+    if (EqualsNoCase_(key, "Content-Length"))
     {
-        // 匹配到空行，进入body字段
-        if (method_ == "POST")
+        char *end = nullptr;
+        unsigned long n = strtoul(line + valOff, &end, 10);
+        if (end != line + valEnd || n > MAX_BODY_LEN)
         {
-            state_ = BODY;
+            LOG_ERROR("Content-Length Error");
+            return false;
         }
-        else
-            state_ = FINISH;
+        contentLen_ = n;
     }
+    return true;
 }
 
-void HttpRequest::ParseBody_(const string &line)
+void HttpRequest::Finish_(const char *begin)
 {
-    if (method_ == "POST")
+    method_ = string_view(begin + methodSpan_.off, methodSpan_.len);
+    version_ = string_view(begin + versionSpan_.off, versionSpan_.len);
+    path_.assign(begin + pathSpan_.off, pathSpan_.len);
+    header_.reserve(headerSpans_.size());
+    for (const auto &span : headerSpans_)
     {
-        LOG_DEBUG("ParseBody : [%s], len : %d", line.c_str(), line.size());
-        body_ = line;
-        ParsePost_();
+        header_.emplace_back(string_view(begin + span.key.off, span.key.len),
+                             string_view(begin + span.value.off, span.value.len));
+    }
+    keepAlive_ = version_ == "1.1" && EqualsNoCase_(GetHeader("Connection"), "keep-alive");
+}
+
+bool HttpRequest::EqualsNoCase_(string_view a, string_view b)
+{
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+void HttpRequest::ParsePath_()
+{
+    if (path_ == "/")
+    {
+        path_ = "/index.html";
+    }
+    else
+    {
+        for (auto &item : DEFAULT_HTML)
+        {
+            if (item == path_)
+            {
+                path_ += ".html";
+                break;
+            }
+        }
     }
-    state_ = FINISH;
 }
 
 int HttpRequest::ConverHex(char ch)
@@ -150,7 +228,7 @@ int HttpRequest::ConverHex(char ch)
 // 对post字段进行处理
 void HttpRequest::ParsePost_()
 {
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded")
+    if (method_ == "POST" && GetHeader("Content-Type") == "application/x-www-form-urlencoded")
     {
         // 先对post字段进行解码，获得账号和密码
         ParseFromUrlencoded_();
@@ -161,21 +239,28 @@ void HttpRequest::ParsePost_()
             LOG_DEBUG("Tag:%d", tag);
             if (tag == 0 || tag == 1)
             {
-                bool isLogin = (tag == 1);
-                // 根据是否登录，分别进行处理，然后重定位到欢迎页。
-                if (UserVerify(post_["username"], post_["password"], isLogin))
-                {
-                    path_ = "/welcome.html";
-                }
-                else
-                {
-                    path_ = "/error.html";
-                }
+                // 要查数据库，留给 Verify() 去做
+                verifyTag_ = tag;
             }
         }
     }
 }
 
+void HttpRequest::Verify()
+{
+    bool isLogin = (verifyTag_ == 1);
+    verifyTag_ = -1;
+    // 根据是否登录，分别进行处理，然后重定位到欢迎页。
+    if (UserVerify(post_["username"], post_["password"], isLogin))
+    {
+        path_ = "/welcome.html";
+    }
+    else
+    {
+        path_ = "/error.html";
+    }
+}
+
 // 从url中解析键值对，示例：action=user_login&username=%E5%8F%91&password=+%E5%8F%91&rememberme=1
 // &是匹配结束，+是空格。上面的是 action=user_login username=%E5%8F%91 password= %E5%8F%91 rememberme=1
 void HttpRequest::ParseFromUrlencoded_()
@@ -323,24 +408,33 @@ std::string &HttpRequest::path()
     return path_;
 }
 
-std::string HttpRequest::method() const
+std::string_view HttpRequest::method() const
 {
     return method_;
 }
 
-std::string HttpRequest::version() const
+std::string_view HttpRequest::version() const
 {
     return version_;
 }
 
-// 查询header中是否有该字段
-bool HttpRequest::IsKeepAlive() const
+// 查询header中的字段，字段名不区分大小写，没有则返回空视图
+std::string_view HttpRequest::GetHeader(std::string_view key) const
 {
-    if (header_.count("Connection") == 1)
+    for (const auto &item : header_)
     {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+        if (EqualsNoCase_(item.first, key))
+        {
+            return item.second;
+        }
     }
-    return false;
+    return std::string_view();
+}
+
+// 解析完成时已经根据 Connection 字段和版本号算好
+bool HttpRequest::IsKeepAlive() const
+{
+    return keepAlive_;
 }
 // 查询post发来的东西，如账户密码等，
 std::string HttpRequest::GetPost(const std::string &key) const
@@ -4,8 +4,10 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <vector>
 #include <errno.h>
+#include <strings.h> // strncasecmp
 #include <mysql/mysql.h> //mysql
 
 #include "../buffer/buffer.h"
@@ -40,17 +42,26 @@ public:
     ~HttpRequest() = default;
 
     void Init();
-    bool parse(Buffer &buff);
+    // 增量解析：数据不完整返回 NO_REQUEST 并记住进度，下次读到新数据后从断点继续；
+    // 解析出一个完整请求返回 GET_REQUEST，并把该请求的字节从 buff 中取走；格式错误返回 BAD_REQUEST。
+    HTTP_CODE parse(Buffer &buff);
 
     std::string path() const;
     std::string &path();
-    std::string method() const;
-    std::string version() const;
+    // method/version/header 都是指向读缓冲区的视图，只在下一次从 socket 读数据之前有效
+    std::string_view method() const;
+    std::string_view version() const;
+    std::string_view GetHeader(std::string_view key) const;
     std::string GetPost(const std::string &key) const;
     std::string GetPost(const char *key) const;
 
     bool IsKeepAlive() const;
 
+    // 登录/注册请求解析完后不在 parse 里直接查数据库，而是记下来由调用方决定在哪个线程做校验：
+    // NeedVerify() 为 true 时调用 Verify() 完成校验并把 path 改成欢迎页或错误页
+    bool NeedVerify() const { return verifyTag_ >= 0; }
+    void Verify();
+
     /*
     todo
     void HttpConn::ParseFormData() {}
@@ -58,9 +69,23 @@ public:
     */
 
 private:
-    bool ParseRequestLine_(const std::string &line); // 解析请求行
-    void ParseHeader_(const std::string &line);      // 解析请求头
-    void ParseBody_(const std::string &line);        // 解析请求体
+    // 相对于请求起始位置(buff.Peek())的一段字节，缓冲区扩容或整理后依然有效
+    struct Span
+    {
+        size_t off;
+        size_t len;
+    };
+    struct HeaderSpan
+    {
+        Span key;
+        Span value;
+    };
+
+    bool ParseRequestLine_(const char *begin, size_t lineStart, size_t lineEnd); // 解析请求行
+    bool ParseHeader_(const char *begin, size_t lineStart, size_t lineEnd);      // 解析请求头
+    void Finish_(const char *begin);                                            // 请求完整后生成视图
+
+    static bool EqualsNoCase_(std::string_view a, std::string_view b);
 
     void ParsePath_();           // 处理请求路径
     void ParsePost_();           // 处理Post事件
@@ -68,9 +93,23 @@ private:
 
     static bool UserVerify(const std::string &name, const std::string &pwd, bool isLogin);
 
+    static const size_t MAX_HEADER_LEN = 8192;    // 请求行 + 请求头的最大长度
+    static const size_t MAX_BODY_LEN = 1024 * 1024; // 请求体的最大长度
+
     PARSE_STATE state_;
-    std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;
+    size_t checked_;   // 已经扫描过的字节数，断点续扫从这里开始
+    size_t lineStart_; // 当前行的起始位置
+    size_t bodyStart_; // 请求体的起始位置
+    size_t contentLen_;
+    bool keepAlive_;
+    int verifyTag_; // 待校验的登录(1)/注册(0)请求，-1 表示没有
+
+    Span methodSpan_, pathSpan_, versionSpan_;
+    std::vector<HeaderSpan> headerSpans_;
+
+    std::string_view method_, version_;
+    std::vector<std::pair<std::string_view, std::string_view>> header_;
+    std::string path_, body_;
     std::unordered_map<std::string, std::string> post_;
 
     static const std::unordered_set<std::string> DEFAULT_HTML;
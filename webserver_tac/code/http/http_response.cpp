@@ -14,11 +14,24 @@ const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
 
 const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     {200, "OK"},
+    {206, "Partial Content"},
+    {304, "Not Modified"},
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
+    {416, "Range Not Satisfiable"},
 };
 
+const unordered_set<string> HttpResponse::COMPRESS_SUFFIX = {
+    ".html", ".xml", ".xhtml", ".txt", ".rtf", ".css", ".js",
+};
+
+const char HttpResponse::BOUNDARY[] = "WEBSERVER_BYTERANGES_BOUNDARY";
+
+size_t HttpResponse::sendfileThreshold = 1024 * 1024;
+
+bool HttpResponse::gzip = true;
+
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
     {400, "/400.html"},
     {403, "/403.html"},
@@ -31,6 +44,10 @@ HttpResponse::HttpResponse()
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
     mmFile_ = nullptr;
+    fileFd_ = -1;
+    encoding_ = IDENTITY;
+    vary_ = false;
+    base_ = mark_ = 0;
     mmFileStat_ = {0};
 };
 
@@ -42,22 +59,28 @@ HttpResponse::~HttpResponse()
 void HttpResponse::Init(const string &srcDir, string &path, bool isKeepAlive, int code)
 {
     assert(srcDir != "");
-    if (mmFile_)
-    {
-        UnmapFile();
-    }
+    UnmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr;
     mmFileStat_ = {0};
 }
 
-void HttpResponse::MakeResponse(Buffer &buff)
+void HttpResponse::MakeResponse(Buffer &buff, const RequestInfo &request)
 {
-    /* 判断请求的资源文件 */
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode))
+    segs_.clear();
+    ranges_.clear();
+    base_ = buff.ReadableBytes();
+    mark_ = 0;
+
+    /* 判断请求的资源文件，stat 结果和映射都来自共享缓存 */
+    file_ = FileCache::Instance()->Acquire(srcDir_ + path_, MapLimit_());
+    if (file_)
+    {
+        mmFileStat_ = file_->st;
+    }
+    if (!file_ || S_ISDIR(mmFileStat_.st_mode))
     {
         code_ = 404;
     }
@@ -69,11 +92,17 @@ void HttpResponse::MakeResponse(Buffer &buff)
     {
         code_ = 200;
     }
+    if (code_ == 200 && S_ISREG(mmFileStat_.st_mode))
+    {
+        SelectEncoding_(request);
+        CheckConditional_(request);
+    }
     // 如果code是4开头的，可以去找到对应的错误网页作为要发送的主体，信息在mmFileStat_里面
     ErrorHtml_();
     AddStateLine_(buff);
     AddHeader_(buff);
     AddContent_(buff);
+    MarkBuff_(buff);
 }
 
 char *HttpResponse::File()
@@ -81,6 +110,17 @@ char *HttpResponse::File()
     return mmFile_;
 }
 
+int HttpResponse::FileFd() const
+{
+    return fileFd_;
+}
+
+// 达到 sendfile 阈值的文件不做映射
+size_t HttpResponse::MapLimit_()
+{
+    return sendfileThreshold > 0 ? sendfileThreshold - 1 : SIZE_MAX;
+}
+
 size_t HttpResponse::FileLen() const
 {
     return mmFileStat_.st_size;
@@ -92,7 +132,12 @@ void HttpResponse::ErrorHtml_()
     if (CODE_PATH.count(code_) == 1)
     {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        file_ = FileCache::Instance()->Acquire(srcDir_ + path_, MapLimit_());
+        mmFileStat_ = {0};
+        if (file_)
+        {
+            mmFileStat_ = file_->st;
+        }
     }
 }
 
@@ -123,42 +168,433 @@ void HttpResponse::AddHeader_(Buffer &buff)
     {
         buff.Append("close\r\n");
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    if (code_ == 206 && ranges_.size() > 1)
+    {
+        buff.Append("Content-type: multipart/byteranges; boundary=" + string(BOUNDARY) + "\r\n");
+    }
+    else
+    {
+        buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    }
+    if (code_ == 200 || code_ == 206 || code_ == 304)
+    {
+        /* 缓存校验信息，浏览器据此发条件请求；Accept-Ranges 告诉客户端可以断点续传/拖动 */
+        buff.Append("Accept-Ranges: bytes\r\n");
+        buff.Append("ETag: " + ETag_() + "\r\n");
+        buff.Append("Last-Modified: " + HttpDate_(mmFileStat_.st_mtime) + "\r\n");
+        if (vary_)
+        {
+            buff.Append("Vary: Accept-Encoding\r\n");
+        }
+        if (encoding_ != IDENTITY && code_ == 200)
+        {
+            buff.Append("Content-Encoding: gzip\r\n");
+        }
+    }
 }
 
 void HttpResponse::AddContent_(Buffer &buff)
 {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
-    if (srcFd < 0)
+    /* 文件映射由 FileCache 完成并在连接之间共享，这里只引用，不再每次 open/mmap/munmap */
+    if (!file_ || !S_ISREG(mmFileStat_.st_mode))
     {
         ErrorContent(buff, "File NotFound!");
         return;
     }
+    size_t size = mmFileStat_.st_size;
+    if (code_ == 304)
+    {
+        buff.Append("\r\n"); // 304 没有响应体
+        return;
+    }
+    if (code_ == 416)
+    {
+        buff.Append("Content-Range: bytes */" + to_string(size) + "\r\n");
+        buff.Append("Content-length: 0\r\n\r\n");
+        return;
+    }
+    if (encoding_ == GZIP_DYNAMIC)
+    {
+        mmFile_ = const_cast<char *>(gzData_->data());
+    }
+    else
+    {
+        if (size > 0 && !file_->data)
+        {
+            /* 大文件: 不映射，直接打开 fd，由 HttpConn 用 sendfile 从页缓存发到 socket，避免缺页和拷贝 */
+            fileFd_ = open((srcDir_ + path_ + (encoding_ == GZIP_STATIC ? ".gz" : "")).data(), O_RDONLY);
+            if (fileFd_ < 0)
+            {
+                ErrorContent(buff, "File NotFound!");
+                return;
+            }
+        }
+        mmFile_ = file_->data;
+    }
+
+    if (code_ != 206)
+    {
+        buff.Append("Content-length: " + to_string(size) + "\r\n\r\n");
+        AddFileSegment_(buff, 0, size);
+        return;
+    }
+    if (ranges_.size() == 1)
+    {
+        const Range &r = ranges_[0];
+        buff.Append("Content-Range: bytes " + to_string(r.start) + "-" + to_string(r.start + r.len - 1) + "/" +
+                    to_string(size) + "\r\n");
+        buff.Append("Content-length: " + to_string(r.len) + "\r\n\r\n");
+        AddFileSegment_(buff, r.start, r.len);
+        return;
+    }
 
-    /* 将文件映射到内存提高文件的访问速度，MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    // mmap 将一个文件或者其它对象映射进内存。
-    // 指定起始位置，填null. 大小. 只可读. 不共享，写回不覆盖. 文件描述符. 偏移为0.
-    // 文件被映射到多个页上，如果文件的大小不是所有页的大小之和，最后一个页不被使用的空间将会清零。
-    // munmap 执行相反的操作，删除特定地址区域的对象映射。
+    /* 多个范围: multipart/byteranges，每段前面有自己的小头部，段头写进 buff，段内容直接引用文件 */
+    vector<string> partHeads;
+    size_t total = 0;
+    for (const Range &r : ranges_)
+    {
+        partHeads.push_back("\r\n--" + string(BOUNDARY) + "\r\nContent-type: " + GetFileType_() +
+                            "\r\nContent-Range: bytes " + to_string(r.start) + "-" + to_string(r.start + r.len - 1) +
+                            "/" + to_string(size) + "\r\n\r\n");
+        total += partHeads.back().size() + r.len;
+    }
+    string closing = "\r\n--" + string(BOUNDARY) + "--\r\n";
+    total += closing.size();
 
-    // LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int *mmRet = (int *)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if (*mmRet == -1)
+    buff.Append("Content-length: " + to_string(total) + "\r\n\r\n");
+    for (size_t i = 0; i < ranges_.size(); i++)
+    {
+        buff.Append(partHeads[i]);
+        AddFileSegment_(buff, ranges_[i].start, ranges_[i].len);
+    }
+    buff.Append(closing);
+}
+
+void HttpResponse::AddFileSegment_(Buffer &buff, size_t off, size_t len)
+{
+    MarkBuff_(buff);
+    if (len > 0)
+    {
+        segs_.push_back({true, off, len});
+    }
+}
+
+// 把 buff 中还没记录的字节作为一个内存段
+void HttpResponse::MarkBuff_(Buffer &buff)
+{
+    size_t end = buff.ReadableBytes() - base_;
+    if (end > mark_)
+    {
+        segs_.push_back({false, mark_, end - mark_});
+        mark_ = end;
+    }
+}
+
+// 文本资源优先发送预压缩的 .gz 文件，没有时发送 GzipCache 里现场压缩的内容；
+// 范围请求始终针对原始内容，不做压缩
+void HttpResponse::SelectEncoding_(const RequestInfo &request)
+{
+    if (!gzip || !Compressible_())
+    {
+        return;
+    }
+    vary_ = true;
+    if (!request.range.empty() || !AcceptGzip_(request.acceptEncoding))
+    {
+        return;
+    }
+    GzipCache::DataPtr data;
+    if (GzipCache::Instance()->Acquire(srcDir_ + path_, file_, &data))
+    {
+        FileCache::FilePtr gzFile = FileCache::Instance()->Acquire(srcDir_ + path_ + ".gz", MapLimit_());
+        if (gzFile && S_ISREG(gzFile->st.st_mode))
+        {
+            /* 长度换成 .gz 的，mtime 仍用源文件的，Last-Modified 和条件请求都以源文件为准 */
+            file_ = gzFile;
+            mmFileStat_.st_size = gzFile->st.st_size;
+            encoding_ = GZIP_STATIC;
+        }
+    }
+    else if (data)
+    {
+        gzData_ = data;
+        mmFileStat_.st_size = data->size();
+        encoding_ = GZIP_DYNAMIC;
+    }
+}
+
+// 条件请求与范围请求，只对能正常返回的常规文件生效
+void HttpResponse::CheckConditional_(const RequestInfo &request)
+{
+    string etag = ETag_();
+    /* If-None-Match 优先于 If-Modified-Since */
+    if (!request.ifNoneMatch.empty())
+    {
+        if (ETagMatch_(request.ifNoneMatch, etag))
+        {
+            code_ = 304;
+            return;
+        }
+    }
+    else if (!request.ifModifiedSince.empty())
+    {
+        time_t since = ParseHttpDate_(request.ifModifiedSince);
+        if (since != -1 && mmFileStat_.st_mtime <= since)
+        {
+            code_ = 304;
+            return;
+        }
+    }
+
+    if (request.range.empty())
+    {
+        return;
+    }
+    if (!request.ifRange.empty())
+    {
+        /* If-Range 不匹配说明客户端手里的是旧版本，返回整个文件 */
+        bool match = request.ifRange.front() == '"' ? request.ifRange == etag
+                                                      : ParseHttpDate_(request.ifRange) == mmFileStat_.st_mtime;
+        if (!match)
+        {
+            return;
+        }
+    }
+    ParseRange_(request.range);
+}
+
+// Range: bytes=0-99,200-,-50；语法错误或范围过多时忽略该头部，全部越界时返回 416
+void HttpResponse::ParseRange_(string_view range)
+{
+    const string_view prefix = "bytes=";
+    if (range.substr(0, prefix.size()) != prefix)
     {
-        ErrorContent(buff, "File NotFound!");
         return;
     }
-    mmFile_ = (char *)mmRet;
-    close(srcFd);
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    range.remove_prefix(prefix.size());
+    size_t size = mmFileStat_.st_size;
+    while (!range.empty())
+    {
+        size_t comma = range.find(',');
+        string_view spec = range.substr(0, comma);
+        range = comma == string_view::npos ? string_view() : range.substr(comma + 1);
+        while (!spec.empty() && (spec.front() == ' ' || spec.front() == '\t'))
+        {
+            spec.remove_prefix(1);
+        }
+        while (!spec.empty() && (spec.back() == ' ' || spec.back() == '\t'))
+        {
+            spec.remove_suffix(1);
+        }
+        if (spec.empty())
+        {
+            continue;
+        }
+
+        size_t dash = spec.find('-');
+        if (dash == string_view::npos)
+        {
+            ranges_.clear();
+            return;
+        }
+        string_view first = spec.substr(0, dash), last = spec.substr(dash + 1);
+        size_t start, end;
+        if (first.empty())
+        {
+            /* -N: 最后 N 个字节 */
+            size_t n;
+            if (!ParseUint_(last, &n))
+            {
+                ranges_.clear();
+                return;
+            }
+            if (n == 0 || size == 0)
+            {
+                continue;
+            }
+            start = n < size ? size - n : 0;
+            end = size - 1;
+        }
+        else
+        {
+            if (!ParseUint_(first, &start) || (!last.empty() && !ParseUint_(last, &end)))
+            {
+                ranges_.clear();
+                return;
+            }
+            if (!last.empty() && end < start)
+            {
+                ranges_.clear();
+                return;
+            }
+            if (start >= size)
+            {
+                continue; // 越界的范围跳过
+            }
+            end = last.empty() ? size - 1 : min(end, size - 1);
+        }
+        ranges_.push_back({start, end - start + 1});
+        if (ranges_.size() > MAX_RANGES)
+        {
+            ranges_.clear();
+            return;
+        }
+    }
+    code_ = ranges_.empty() ? 416 : 206;
+}
+
+// 由 mtime 和文件大小生成，文件一变就不同
+string HttpResponse::ETag_() const
+{
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx%s\"", static_cast<unsigned long>(mmFileStat_.st_mtime),
+             static_cast<unsigned long>(mmFileStat_.st_size), encoding_ == IDENTITY ? "" : "-gz");
+    return etag;
+}
+
+// If-None-Match: "a", W/"b" 或 *，按弱比较处理
+bool HttpResponse::ETagMatch_(string_view list, const string &etag)
+{
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        string_view tag = list.substr(0, comma);
+        list = comma == string_view::npos ? string_view() : list.substr(comma + 1);
+        while (!tag.empty() && tag.front() == ' ')
+        {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && tag.back() == ' ')
+        {
+            tag.remove_suffix(1);
+        }
+        if (tag.substr(0, 2) == "W/")
+        {
+            tag.remove_prefix(2);
+        }
+        if (tag == "*" || tag == etag)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Accept-Encoding: gzip;q=0.8, br, *;q=0 —— 显式的 gzip 优先于 *，q=0 表示拒绝
+bool HttpResponse::AcceptGzip_(string_view list)
+{
+    int gz = -1, star = -1; // -1 未出现，0 拒绝，1 接受
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        string_view item = list.substr(0, comma);
+        list = comma == string_view::npos ? string_view() : list.substr(comma + 1);
+
+        size_t semi = item.find(';');
+        string_view coding = item.substr(0, semi);
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t'))
+        {
+            coding.remove_prefix(1);
+        }
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t'))
+        {
+            coding.remove_suffix(1);
+        }
+        int accept = 1;
+        if (semi != string_view::npos)
+        {
+            string_view param = item.substr(semi + 1);
+            size_t q = param.find("q=");
+            if (q != string_view::npos)
+            {
+                /* q 值形如 0、0.000、1、0.5，只要小数点前后都是 0 就是拒绝 */
+                string_view value = param.substr(q + 2);
+                accept = 0;
+                for (char ch : value)
+                {
+                    if (ch >= '1' && ch <= '9')
+                    {
+                        accept = 1;
+                        break;
+                    }
+                    if (ch != '0' && ch != '.')
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        if (coding.size() == 4 && strncasecmp(coding.data(), "gzip", 4) == 0)
+        {
+            gz = accept;
+        }
+        else if (coding == "*")
+        {
+            star = accept;
+        }
+    }
+    return gz == 1 || (gz == -1 && star == 1);
+}
+
+bool HttpResponse::ParseUint_(string_view str, size_t *value)
+{
+    if (str.empty() || str.size() > 19)
+    {
+        return false;
+    }
+    size_t v = 0;
+    for (char ch : str)
+    {
+        if (ch < '0' || ch > '9')
+        {
+            return false;
+        }
+        v = v * 10 + (ch - '0');
+    }
+    *value = v;
+    return true;
+}
+
+// RFC 7231 的 IMF-fixdate，例如 Sun, 06 Nov 1994 08:49:37 GMT
+string HttpResponse::HttpDate_(time_t t)
+{
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char date[64];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return date;
+}
+
+time_t HttpResponse::ParseHttpDate_(string_view date)
+{
+    char str[64];
+    if (date.size() >= sizeof(str))
+    {
+        return -1;
+    }
+    memcpy(str, date.data(), date.size());
+    str[date.size()] = '\0';
+    struct tm tm{};
+    const char *end = strptime(str, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr || *end != '\0')
+    {
+        return -1;
+    }
+    return timegm(&tm);
 }
 
 void HttpResponse::UnmapFile()
 {
-    if (mmFile_)
+    /* 只是释放引用，真正的 munmap 发生在缓存淘汰且没有响应再引用它时 */
+    mmFile_ = nullptr;
+    file_.reset();
+    gzData_.reset();
+    encoding_ = IDENTITY;
+    vary_ = false;
+    if (fileFd_ >= 0)
     {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
+        close(fileFd_);
+        fileFd_ = -1;
     }
 }
 
@@ -178,6 +614,12 @@ string HttpResponse::GetFileType_()
     return "text/plain";
 }
 
+bool HttpResponse::Compressible_() const
+{
+    string::size_type idx = path_.find_last_of('.');
+    return idx != string::npos && COMPRESS_SUFFIX.count(path_.substr(idx)) == 1;
+}
+
 // 这个是连html都找到不到，就构造字符串发送。
 void HttpResponse::ErrorContent(Buffer &buff, string message)
 {
@@ -2,24 +2,55 @@
 #define HTTP_RESPONSE_H
 
 #include <fcntl.h>    // open
+#include <string_view>
+#include <strings.h>  // strncasecmp
 #include <sys/mman.h> // mmap, munmap
 #include <sys/stat.h> // stat
+#include <time.h>     // strftime, strptime, timegm
 #include <unistd.h>   // close
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "../buffer/buffer.h"
+#include "file_cache.h"
+#include "gzip_cache.h"
 // #include "../log/log.h"
 
 class HttpResponse
 {
   public:
+    // 影响响应内容的请求头，视图指向读缓冲区，只在 MakeResponse 期间使用
+    struct RequestInfo
+    {
+        std::string_view range;           // Range
+        std::string_view ifRange;         // If-Range
+        std::string_view ifNoneMatch;     // If-None-Match
+        std::string_view ifModifiedSince; // If-Modified-Since
+        std::string_view acceptEncoding;  // Accept-Encoding
+    };
+
+    // 响应由若干段按顺序组成：inFile 为 false 时是 buff 中的字节，off 相对于本响应在 buff 中的起点；
+    // inFile 为 true 时是文件中 [off, off + len) 的内容
+    struct Segment
+    {
+        bool inFile;
+        size_t off;
+        size_t len;
+    };
+
     HttpResponse();
     ~HttpResponse();
 
     void Init(const std::string &srcDir, std::string &path, bool isKeepAlive = false, int code = -1);
-    void MakeResponse(Buffer &buff);
+    void MakeResponse(Buffer &buff, const RequestInfo &request = RequestInfo());
+    const std::vector<Segment> &Segments() const
+    {
+        return segs_;
+    }
     void UnmapFile();
     char *File();
+    int FileFd() const; // 走 sendfile 的大文件返回打开的 fd，否则为 -1
     size_t FileLen() const;
     void ErrorContent(Buffer &buff, std::string message);
     int Code() const
@@ -27,13 +58,31 @@ class HttpResponse
         return code_;
     }
 
+    static size_t sendfileThreshold; // 不小于该大小的文件用 sendfile 发送，0 表示总是 mmap
+    static bool gzip;                // 文本资源是否按 Accept-Encoding 发送 gzip 版本
+
   private:
     void AddStateLine_(Buffer &buff);
     void AddHeader_(Buffer &buff);
     void AddContent_(Buffer &buff);
+    void AddFileSegment_(Buffer &buff, size_t off, size_t len);
+    void MarkBuff_(Buffer &buff);
+
+    void SelectEncoding_(const RequestInfo &request);   // 可能换成 .gz 文件或现场压缩的内容
+    void CheckConditional_(const RequestInfo &request); // 可能把 200 改成 304/206/416
+    void ParseRange_(std::string_view range);
+    std::string ETag_() const;
+
+    static bool ETagMatch_(std::string_view list, const std::string &etag);
+    static bool AcceptGzip_(std::string_view list);
+    static bool ParseUint_(std::string_view str, size_t *value);
+    static std::string HttpDate_(time_t t);
+    static time_t ParseHttpDate_(std::string_view date);
 
     void ErrorHtml_();
+    static size_t MapLimit_();
     std::string GetFileType_();
+    bool Compressible_() const;
 
     int code_;
     bool isKeepAlive_;
@@ -43,10 +92,36 @@ class HttpResponse
 
     char *mmFile_;
     struct stat mmFileStat_;
+    FileCache::FilePtr file_; // 持有共享映射的引用，UnmapFile 时释放
+    int fileFd_;
+
+    enum ENCODING
+    {
+        IDENTITY,
+        GZIP_STATIC,  // 发送 .gz 兄弟文件
+        GZIP_DYNAMIC, // 发送 GzipCache 中现场压缩的内容
+    };
+    ENCODING encoding_;
+    bool vary_; // 响应内容随 Accept-Encoding 变化
+    GzipCache::DataPtr gzData_;
+
+    struct Range
+    {
+        size_t start;
+        size_t len;
+    };
+    std::vector<Range> ranges_; // 206 时要发送的字节范围
+    std::vector<Segment> segs_;
+    size_t base_; // 本响应在 buff 中的起点
+    size_t mark_; // buff 中已经记入 segs_ 的位置(相对 base_)
+
+    static const size_t MAX_RANGES = 16;
+    static const char BOUNDARY[];
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE; // 后缀类型集
     static const std::unordered_map<int, std::string> CODE_STATUS;         // 编码状态集
     static const std::unordered_map<int, std::string> CODE_PATH;           // 编码路径集
+    static const std::unordered_set<std::string> COMPRESS_SUFFIX;          // 值得压缩的文本类型
 };
 
 #endif // HTTP_RESPONSE_H
\ No newline at end of file
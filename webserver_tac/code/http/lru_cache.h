@@ -0,0 +1,95 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// 按路径索引、按字节预算 LRU 淘汰的缓存表，FileCache 和 GzipCache 共用
+// 每个条目带一个字节数，总字节数超过预算时从最久未使用的一端淘汰；
+// 自身不加锁，由使用者在自己的锁内调用。
+template <class V> class LruCache
+{
+  public:
+    explicit LruCache(size_t capacity) : bytes_(0), capacity_(capacity)
+    {
+    }
+
+    // 命中时移到最前并返回条目，指针在下一次修改之前有效；未命中返回 nullptr
+    V *Find(const std::string &key)
+    {
+        auto it = entries_.find(key);
+        if (it == entries_.end())
+        {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        return &it->second.value;
+    }
+
+    // 插入或替换条目并放到最前，之后按预算淘汰(条目本身超出预算时也会被淘汰)
+    void Put(const std::string &key, V value, size_t bytes)
+    {
+        Erase(key);
+        lru_.push_front(key);
+        entries_.emplace(key, Node{std::move(value), bytes, lru_.begin()});
+        bytes_ += bytes;
+        Evict_();
+    }
+
+    void Erase(const std::string &key)
+    {
+        auto it = entries_.find(key);
+        if (it == entries_.end())
+        {
+            return;
+        }
+        bytes_ -= it->second.bytes;
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+
+    void SetCapacity(size_t capacity)
+    {
+        capacity_ = capacity;
+        Evict_();
+    }
+
+    void Clear()
+    {
+        entries_.clear();
+        lru_.clear();
+        bytes_ = 0;
+    }
+
+    size_t Bytes() const
+    {
+        return bytes_;
+    }
+
+  private:
+    struct Node
+    {
+        V value;
+        size_t bytes;
+        std::list<std::string>::iterator lru;
+    };
+
+    // 从最久未使用的一端淘汰，直到回到预算以内
+    void Evict_()
+    {
+        while (bytes_ > capacity_ && !lru_.empty())
+        {
+            std::string victim = lru_.back();
+            Erase(victim);
+        }
+    }
+
+    std::unordered_map<std::string, Node> entries_;
+    std::list<std::string> lru_; // 越靠前越是最近使用
+    size_t bytes_;
+    size_t capacity_;
+};
+
+#endif // LRU_CACHE_H
@@ -0,0 +1,236 @@
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// 二进制日志(延迟格式化)的记录格式，Log 写、tools/log_decoder 读，两边共用。
+// 热路径上不做 vsnprintf：每个调用点第一次执行时登记一次格式串，得到 id；
+// 之后每次只写 id、时间戳和参数的原始字节，由离线的 log_decoder 还原成和文本模式一样的行。
+//
+// 文件由连续的记录组成，每条记录以 4 字节总长度开头(小端，含这 4 字节)：
+//   数据记录: len, id,     time(自 1970 起的微秒, 8 字节), 参数...
+//   格式记录: len, DEF_ID, id, level, line, 参数类型串\0, 源文件\0, 格式串\0
+// 写线程保证一个 id 的格式记录在同一文件里先于它的数据记录出现(换文件时重新写一遍全部格式记录)。
+//
+// 参数按编译期推出的类型紧凑存放，类型串里每个参数一个字符：
+//   i int32  I int64  u uint32  U uint64  d double  p 指针(8 字节)  s 字符串(2 字节长度 + 内容，不含 '\0')
+// 字符串类型的参数在登记时再对照格式串修正：对应的转换不是 %s(如 %p)的记成指针，
+// %.Ns / %.*s 最多只读 N 个字节，参数可以不以 '\0' 结尾。
+namespace binlog
+{
+
+const uint32_t DEF_ID = 0xFFFFFFFF;
+const size_t MAX_STRING = 0xFFFF;
+
+template <class T> constexpr char TagOf()
+{
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool> || std::is_enum_v<U>)
+        return 'i';
+    else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+        return sizeof(U) <= 4 ? 'i' : 'I';
+    else if constexpr (std::is_integral_v<U>)
+        return sizeof(U) <= 4 ? 'u' : 'U';
+    else if constexpr (std::is_floating_point_v<U>)
+        return 'd';
+    else if constexpr (std::is_same_v<U, char *> || std::is_same_v<U, const char *> || std::is_same_v<U, std::string>)
+        return 's';
+    else if constexpr (std::is_pointer_v<U>)
+        return 'p';
+    else
+        static_assert(std::is_pointer_v<U>, "unsupported log argument type");
+}
+
+// 参数类型串，只在 decltype 里用，不会真的求值参数
+template <class... Args> struct Signature
+{
+    static const char *Value()
+    {
+        static const char tags[] = {TagOf<Args>()..., '\0'};
+        return tags;
+    }
+};
+template <class... Args> Signature<Args...> Tags(const Args &...);
+
+const int NO_PRECISION = -1;
+const int STAR_PRECISION = -2; // %.*s，精度是前一个参数
+
+// 一个参数在格式串里的用法，只对字符串类型的参数有意义
+struct ArgSpec
+{
+    bool asPointer; // 对应的转换不是 %s，按指针记录
+    int precision;  // %.Ns 的 N，或 NO_PRECISION / STAR_PRECISION
+};
+
+// 一个调用点登记后的结果：格式串 id 和每个参数的用法
+struct Site
+{
+    uint32_t id;
+    std::vector<ArgSpec> specs;
+};
+
+// 对照格式串分析每个参数的用法，并把 signature 里按指针记录的字符串参数改成 'p'。
+// 长度修饰符、标志、宽度都不影响参数怎么记录，只看精度和转换字符；'*' 宽度/精度各占一个参数
+inline std::vector<ArgSpec> ParseFormat(const char *format, std::string &signature)
+{
+    std::vector<ArgSpec> specs(signature.size(), ArgSpec{false, NO_PRECISION});
+    size_t next = 0;
+    for (const char *p = format; *p; p++)
+    {
+        if (*p != '%')
+        {
+            continue;
+        }
+        if (*++p == '%')
+        {
+            continue;
+        }
+        int precision = NO_PRECISION;
+        for (; *p && strchr("-+ #0'123456789*", *p); p++)
+        {
+            next += *p == '*';
+        }
+        if (*p == '.')
+        {
+            precision = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++)
+            {
+                precision = precision * 10 + (*p - '0');
+            }
+            if (*p == '*')
+            {
+                precision = STAR_PRECISION;
+                next++;
+                p++;
+            }
+        }
+        for (; *p && strchr("hlLqjzt", *p); p++)
+        {
+        }
+        if (*p == '\0' || next >= specs.size())
+        {
+            break;
+        }
+        if (signature[next] == 's')
+        {
+            if (*p == 's')
+            {
+                specs[next].precision = precision;
+            }
+            else
+            {
+                specs[next].asPointer = true;
+                signature[next] = 'p';
+            }
+        }
+        next++;
+    }
+    return specs;
+}
+
+// 往定长缓冲区里顺序写，写不下的字符串截断，定长字段写不下就丢掉(调用方按 LINE_SIZE 分配，正常不会发生)
+class Encoder
+{
+  public:
+    Encoder(char *begin, char *end, const std::vector<ArgSpec> &specs)
+        : begin_(begin), cur_(begin), end_(end), specs_(specs), index_(0), lastInt_(0)
+    {
+    }
+
+    template <class T> void Put(T v)
+    {
+        if (end_ - cur_ >= static_cast<long>(sizeof(T)))
+        {
+            memcpy(cur_, &v, sizeof(T));
+            cur_ += sizeof(T);
+        }
+    }
+
+    void PutString(const char *s, size_t len)
+    {
+        long room = end_ - cur_ - 2;
+        if (room < 0)
+        {
+            return;
+        }
+        len = std::min({len, MAX_STRING, static_cast<size_t>(room)});
+        Put<uint16_t>(static_cast<uint16_t>(len));
+        memcpy(cur_, s, len);
+        cur_ += len;
+    }
+
+    template <class T> void Arg(const T &v)
+    {
+        using U = std::decay_t<T>;
+        constexpr char tag = TagOf<T>();
+        if constexpr (std::is_same_v<U, std::string>)
+            String(v.data(), v.size(), true);
+        else if constexpr (tag == 's')
+            String(v, 0, false);
+        else if constexpr (tag == 'p')
+            Put<uint64_t>(reinterpret_cast<uintptr_t>(v));
+        else if constexpr (tag == 'd')
+            Put<double>(static_cast<double>(v));
+        else
+        {
+            lastInt_ = static_cast<long long>(v); // 可能是下一个 %.*s 的精度
+            if constexpr (tag == 'i')
+                Put<int32_t>(static_cast<int32_t>(v));
+            else if constexpr (tag == 'I')
+                Put<int64_t>(static_cast<int64_t>(v));
+            else if constexpr (tag == 'u')
+                Put<uint32_t>(static_cast<uint32_t>(v));
+            else
+                Put<uint64_t>(static_cast<uint64_t>(v));
+        }
+        index_++;
+    }
+
+    size_t Size() const
+    {
+        return cur_ - begin_;
+    }
+
+  private:
+    // 字符串类型的参数: 按登记时的用法记成指针，或只读到精度为止
+    void String(const char *s, size_t len, bool sized)
+    {
+        const ArgSpec *spec = index_ < specs_.size() ? &specs_[index_] : nullptr;
+        if (spec && spec->asPointer)
+        {
+            Put<uint64_t>(reinterpret_cast<uintptr_t>(s));
+            return;
+        }
+        if (s == nullptr)
+        {
+            PutString("(null)", 6);
+            return;
+        }
+        long long limit = !spec ? -1 : spec->precision == STAR_PRECISION ? lastInt_ : spec->precision;
+        if (limit < 0)
+        {
+            len = sized ? len : strlen(s);
+        }
+        else
+        {
+            len = sized ? std::min(len, static_cast<size_t>(limit)) : strnlen(s, static_cast<size_t>(limit));
+        }
+        PutString(s, len);
+    }
+
+    char *begin_;
+    char *cur_;
+    char *end_;
+    const std::vector<ArgSpec> &specs_;
+    size_t index_;      // 下一个参数的下标
+    long long lastInt_; // 上一个整数参数
+};
+
+} // namespace binlog
+
+#endif // BINLOG_H
@@ -1,6 +1,7 @@
 #ifndef BLOCKQUEUE_H
 #define BLOCKQUEUE_H
 
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
@@ -28,6 +29,8 @@ template <class T> class BlockDeque
     void push_front(const T &item);
     bool pop(T &item);
     bool pop(T &item, int timeout);
+    bool pop(T &item, std::chrono::milliseconds timeout); // 超时或已关闭返回 false
+    bool closed();
     void flush();
 
   private:
@@ -167,4 +170,27 @@ template <class T> bool BlockDeque<T>::pop(T &item, int timeout)
     return true;
 }
 
+template <class T> bool BlockDeque<T>::pop(T &item, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> locker(mtx_);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (deq_.empty())
+    {
+        if (isClose_ || condConsumer_.wait_until(locker, deadline) == std::cv_status::timeout)
+        {
+            return false;
+        }
+    }
+    item = deq_.front();
+    deq_.pop_front();
+    condProducer_.notify_one();
+    return true;
+}
+
+template <class T> bool BlockDeque<T>::closed()
+{
+    std::lock_guard<std::mutex> locker(mtx_);
+    return isClose_;
+}
+
 #endif // BLOCKQUEUE_H
\ No newline at end of file
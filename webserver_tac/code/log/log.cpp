@@ -1,4 +1,5 @@
 #include "log.h"
+#include <limits.h> // IOV_MAX
 using namespace std;
 
 // 同步模式：write存进buf之后，直接放到文件里，然后flush只是更新文件
@@ -8,16 +9,34 @@ using namespace std;
 Log::Log()
 {
     lineCount_ = 0;
+    isOpen_ = false;
     isAsync_ = false;
     writeThread_ = nullptr;
     deque_ = nullptr;
     toDay_ = 0;
     fp_ = nullptr;
+    writerSleeping_ = false;
+    ringClosed_ = false;
+    flushIntervalMs_ = 500;
+    flushBytes_ = 64 * 1024;
+    flushLevel_ = 2; // WARN
+    flushRequested_ = false;
+    syncPending_ = 0;
+    lastFlush_ = chrono::steady_clock::now();
+    binary_ = false;
+    formatsWritten_ = 0;
 }
 
 Log::~Log()
 {
-    if (writeThread_ && writeThread_->joinable())
+    if (writeThread_ && writeThread_->joinable() && ring_)
+    {
+        // 写线程把环形缓冲里剩下的都写出去才退出
+        ringClosed_ = true;
+        WakeWriter_();
+        writeThread_->join();
+    }
+    else if (writeThread_ && writeThread_->joinable())
     {
         while (!deque_->empty())
         {
@@ -29,46 +48,13 @@ Log::~Log()
     if (fp_)
     {
         lock_guard<mutex> locker(mtx_);
-        flush();
         fclose(fp_);
     }
 }
 
-int Log::GetLevel()
+void Log::init(int level = 1, const char *path, const char *suffix, int maxQueueSize, bool ringQueue, bool binary)
 {
-    lock_guard<mutex> locker(mtx_);
-    return level_;
-}
-
-void Log::SetLevel(int level)
-{
-    lock_guard<mutex> locker(mtx_);
     level_ = level;
-}
-
-void Log::init(int level = 1, const char *path, const char *suffix, int maxQueueSize)
-{
-    isOpen_ = true;
-    level_ = level;
-    if (maxQueueSize > 0)
-    {
-        isAsync_ = true;
-        if (!deque_)
-        {
-            // 因为unique_ptr不支持普通的拷贝或赋值操作,所以采用move
-            // 将动态申请的内存权给deque，newDeque被释放
-            unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
-            deque_ = move(newDeque);
-
-            std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
-            writeThread_ = move(NewThread);
-        }
-    }
-    else
-    {
-        isAsync_ = false;
-    }
-
     lineCount_ = 0;
 
     time_t timer = time(nullptr);
@@ -81,6 +67,7 @@ void Log::init(int level = 1, const char *path, const char *suffix, int maxQueue
              suffix_);
     toDay_ = t.tm_mday;
 
+    // 先打开文件再启动写线程，写线程一启动就可能往 fp_ 里写
     {
         lock_guard<mutex> locker(mtx_);
         buff_.RetrieveAll();
@@ -98,17 +85,82 @@ void Log::init(int level = 1, const char *path, const char *suffix, int maxQueue
         }
         assert(fp_ != nullptr);
     }
+
+    if (maxQueueSize > 0)
+    {
+        isAsync_ = true;
+        if (ringQueue && !deque_ && !ring_)
+        {
+            // 单行最长 LINE_SIZE，缓冲区至少要能放下 4 行(见 MpscRingBuffer::MaxRecord)
+            size_t bytes = max(static_cast<size_t>(maxQueueSize) * RING_LINE_BYTES, static_cast<size_t>(LINE_SIZE) * 4);
+            ring_.reset(new MpscRingBuffer(bytes));
+            binary_ = binary;
+            writeThread_.reset(new thread(FlushLogThread));
+        }
+        else if (!deque_ && !ring_)
+        {
+            // 因为unique_ptr不支持普通的拷贝或赋值操作,所以采用move
+            // 将动态申请的内存权给deque，newDeque被释放
+            unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
+            deque_ = move(newDeque);
+
+            std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
+            writeThread_ = move(NewThread);
+        }
+    }
+    else
+    {
+        isAsync_ = false;
+    }
+
+    // 最后才对外发布，LOG_ 宏看到 IsOpen() 为 true 时文件和写线程都已就绪
+    isOpen_.store(true, memory_order_release);
+}
+
+// 时间前缀 "YYYY-MM-DD HH:MM:SS.uuuuuu " 写到 stamp(TIME_LEN 字节，不含 '\0')，返回对应的本地时间。
+// 每个线程缓存当前这一秒格式化好的结果，同一秒内只改写微秒那 6 位；
+// 换秒时才调 localtime_r(localtime 每次都要加 glibc 的锁、检查 TZ 文件)
+const struct tm &Log::FormatTime_(const struct timeval &now, char *stamp)
+{
+    thread_local time_t cachedSec = -1;
+    thread_local struct tm cachedTm;
+    thread_local char cached[64]; // 年份等字段理论上可能超长，留够余量
+
+    if (now.tv_sec != cachedSec)
+    {
+        time_t tSec = now.tv_sec;
+        localtime_r(&tSec, &cachedTm);
+        snprintf(cached, sizeof(cached), "%04d-%02d-%02d %02d:%02d:%02d.000000 ", cachedTm.tm_year + 1900,
+                 cachedTm.tm_mon + 1, cachedTm.tm_mday, cachedTm.tm_hour, cachedTm.tm_min, cachedTm.tm_sec);
+        cachedSec = now.tv_sec;
+    }
+    memcpy(stamp, cached, TIME_LEN);
+    long usec = now.tv_usec;
+    for (int i = TIME_LEN - 2; i >= TIME_LEN - 7; i--)
+    {
+        stamp[i] = static_cast<char>('0' + usec % 10);
+        usec /= 10;
+    }
+    return cachedTm;
 }
 
 void Log::write(int level, const char *format, ...)
 {
     struct timeval now = {0, 0};
     gettimeofday(&now, nullptr);
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    char stamp[TIME_LEN];
+    const struct tm &t = FormatTime_(now, stamp);
     va_list vaList;
 
+    if (ring_)
+    {
+        // 无锁异步模式：不加锁，文件切换交给写线程
+        va_start(vaList, format);
+        WriteRing_(level, stamp, format, vaList);
+        va_end(vaList);
+        return;
+    }
+
     /* 日志日期 日志行数 */
     if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0)))
     {
@@ -131,7 +183,6 @@ void Log::write(int level, const char *format, ...)
         }
 
         locker.lock();
-        flush();
         fclose(fp_);
         fp_ = fopen(newFile, "a");
         assert(fp_ != nullptr);
@@ -140,10 +191,7 @@ void Log::write(int level, const char *format, ...)
     {
         unique_lock<mutex> locker(mtx_);
         lineCount_++;
-        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ", t.tm_year + 1900, t.tm_mon + 1,
-                         t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-
-        buff_.HasWritten(n);
+        buff_.Append(stamp, TIME_LEN);
         AppendLogLevelTitle_(level);
 
         va_start(vaList, format);
@@ -157,11 +205,25 @@ void Log::write(int level, const char *format, ...)
         if (isAsync_ && deque_ && !deque_->full())
         {
             deque_->push_back(buff_.RetrieveAllToStr());
+            if (level >= flushLevel_.load(memory_order_relaxed))
+            {
+                deque_->push_back(string()); // 空串是刷盘标记，写线程写完这一行就刷
+            }
         }
         // 同步方式（直接向文件中写入日志信息）
         else
         {
+            syncPending_ += buff_.ReadableBytes() - 1;
             fputs(buff_.Peek(), fp_);
+            auto now = chrono::steady_clock::now();
+            if (level >= flushLevel_.load(memory_order_relaxed) ||
+                syncPending_ >= static_cast<size_t>(flushBytes_.load(memory_order_relaxed)) ||
+                now - lastFlush_ >= chrono::milliseconds(flushIntervalMs_.load(memory_order_relaxed)))
+            {
+                fflush(fp_);
+                syncPending_ = 0;
+                lastFlush_ = now;
+            }
         }
         buff_.RetrieveAll();
     }
@@ -189,35 +251,291 @@ void Log::AppendLogLevelTitle_(int level)
     }
 }
 
-// 唤醒阻塞队列消费者，开始写日志
+// 异步模式只通知写线程刷盘，同步模式直接刷
 void Log::flush()
 {
+    if (ring_)
+    {
+        flushRequested_ = true;
+        if (writerSleeping_.load())
+        {
+            WakeWriter_();
+        }
+        return;
+    }
     if (isAsync_)
     {
-        deque_->flush();
+        if (!deque_->full())
+        {
+            deque_->push_back(string());
+        }
+        return;
     }
+    lock_guard<mutex> locker(mtx_);
     fflush(fp_);
+    syncPending_ = 0;
+    lastFlush_ = chrono::steady_clock::now();
+}
+
+void Log::SetFlushPolicy(int intervalMs, int bytes, int level)
+{
+    flushIntervalMs_ = max(intervalMs, 1);
+    flushBytes_ = max(bytes, 1);
+    flushLevel_ = level;
 }
 
-// 懒汉模式
-Log *Log::Instance()
+size_t Log::RingFlushBytes_()
 {
-    static Log inst;
-    return &inst;
+    // 不超过容量的一半，否则缓冲区满了也等不到
+    return min(static_cast<size_t>(flushBytes_.load(memory_order_relaxed)), ring_->Capacity() / 2);
 }
 
 void Log::AsyncWrite_()
 {
     string str = "";
-    while (deque_->pop(str))
+    size_t pending = 0;
+    auto lastFlush = chrono::steady_clock::now();
+    while (true)
     {
+        auto interval = chrono::milliseconds(flushIntervalMs_.load(memory_order_relaxed));
+        bool got = deque_->pop(str, interval);
+        if (!got && deque_->closed())
+        {
+            break;
+        }
         lock_guard<mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+        if (got && !str.empty())
+        {
+            fputs(str.c_str(), fp_);
+            pending += str.size() - 1; // 末尾的 '\0' 不写出
+        }
+        auto now = chrono::steady_clock::now();
+        // 超时说明空闲了，顺带把同步兜底路径直接写进 fp_ 的也刷掉
+        if (!got || (pending > 0 && (str.empty() || pending >= static_cast<size_t>(flushBytes_.load(memory_order_relaxed)) ||
+                                     now - lastFlush >= interval)))
+        {
+            fflush(fp_);
+            pending = 0;
+            lastFlush = now;
+        }
     }
 }
 
 // 异步日志的写线程函数
 void Log::FlushLogThread()
 {
-    Log::Instance()->AsyncWrite_();
+    Log *log = Log::Instance();
+    if (log->ring_)
+    {
+        log->AsyncWriteRing_();
+    }
+    else
+    {
+        log->AsyncWrite_();
+    }
+}
+
+void Log::WriteRing_(int level, const char *stamp, const char *format, va_list vaList)
+{
+    static const char *TITLES[] = {"[debug]: ", "[info] : ", "[warn] : ", "[error]: "};
+    thread_local char line[LINE_SIZE];
+
+    int n = TIME_LEN;
+    memcpy(line, stamp, TIME_LEN);
+    memcpy(line + n, TITLES[level >= 0 && level <= 3 ? level : 1], 9);
+    n += 9;
+
+    int avail = LINE_SIZE - n - 1; // 留一个字节给换行
+    int m = vsnprintf(line + n, avail, format, vaList);
+    if (m < 0)
+    {
+        m = 0;
+    }
+    else if (m >= avail)
+    {
+        m = avail - 1; // 截断
+    }
+    n += m;
+    line[n++] = '\n';
+    PushRing_(level, line, n);
+}
+
+void Log::PushRing_(int level, const char *data, size_t len)
+{
+    while (!ring_->TryPush(data, len))
+    {
+        // 缓冲区满了，叫醒写线程腾地方
+        flushRequested_ = true;
+        WakeWriter_();
+        this_thread::yield();
+    }
+    bool urgent = level >= flushLevel_.load(memory_order_relaxed);
+    if (urgent)
+    {
+        flushRequested_.store(true); // seq_cst，不能和下面读 writerSleeping_ 重排
+    }
+    // 和写线程置 writerSleeping_ 后再检查等待条件配对，保证不会两边都错过：
+    // TryPush 推进 head_ 的 CAS 和这里的读都是 seq_cst，普通行不用再加一次 fence(x86 上 mfence 要几十 ns)。
+    // 攒够字节数或有要紧的行才叫醒，其余的等写线程按间隔醒来一起写
+    if (writerSleeping_.load() && (urgent || ring_->Size() >= RingFlushBytes_()))
+    {
+        WakeWriter_();
+    }
+}
+
+void Log::WakeWriter_()
+{
+    {
+        lock_guard<mutex> locker(ringMtx_);
+    }
+    ringCond_.notify_one();
+}
+
+// 把 iov 全部写出，处理 writev 部分写入
+static void WriteAll(int fd, struct iovec *iov, int cnt)
+{
+    while (cnt > 0)
+    {
+        ssize_t len = writev(fd, iov, min(cnt, IOV_MAX));
+        if (len < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        while (cnt > 0 && static_cast<size_t>(len) >= iov->iov_len)
+        {
+            len -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + len;
+            iov->iov_len -= len;
+        }
+    }
+}
+
+char *Log::BinaryBuffer_()
+{
+    thread_local char rec[LINE_SIZE];
+    return rec;
+}
+
+binlog::Site Log::RegisterFormat(int level, const char *file, int line, const char *format, const char *signature)
+{
+    string sig = signature;
+    vector<binlog::ArgSpec> specs = binlog::ParseFormat(format, sig);
+    string rec(4, '\0'); // 总长度，最后回填
+    uint32_t head[4] = {binlog::DEF_ID, 0, static_cast<uint32_t>(level), static_cast<uint32_t>(line)};
+    lock_guard<mutex> locker(formatMtx_);
+    head[1] = static_cast<uint32_t>(formats_.size());
+    rec.append(reinterpret_cast<const char *>(head), sizeof(head));
+    rec.append(sig.c_str(), sig.size() + 1);
+    rec.append(file, strlen(file) + 1);
+    rec.append(format, strlen(format) + 1);
+    uint32_t len = static_cast<uint32_t>(rec.size());
+    memcpy(&rec[0], &len, sizeof(len));
+    formats_.push_back(move(rec));
+    return {head[1], move(specs)};
+}
+
+// 批里的数据记录用到的 id 都是在它们入队之前登记的，所以在 Peek 之后补写就不会漏
+void Log::WriteFormats_()
+{
+    string pending;
+    {
+        lock_guard<mutex> locker(formatMtx_);
+        for (; formatsWritten_ < formats_.size(); formatsWritten_++)
+        {
+            pending += formats_[formatsWritten_];
+        }
+    }
+    if (!pending.empty())
+    {
+        struct iovec iov = {&pending[0], pending.size()};
+        WriteAll(fileno(fp_), &iov, 1);
+    }
+}
+
+void Log::RotateRing_(int lines)
+{
+    time_t timer = time(nullptr);
+    struct tm t;
+    localtime_r(&timer, &t);
+
+    unsigned int part = lineCount_ / MAX_LINES;
+    bool newDay = toDay_ != t.tm_mday;
+    // 按批切换：一批跨过 MAX_LINES 的边界时整批写进新文件，所以每个文件略少于 MAX_LINES 行
+    if (!newDay && (lineCount_ == 0 || (lineCount_ + lines) / MAX_LINES == part))
+    {
+        lineCount_ += lines;
+        return;
+    }
+
+    char newFile[LOG_NAME_LEN];
+    char tail[36] = {0};
+    snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    if (newDay)
+    {
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
+        toDay_ = t.tm_mday;
+        lineCount_ = 0;
+    }
+    else
+    {
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%u%s", path_, tail, part + 1, suffix_);
+    }
+    lineCount_ += lines;
+
+    lock_guard<mutex> locker(mtx_);
+    fclose(fp_);
+    fp_ = fopen(newFile, "a");
+    assert(fp_ != nullptr);
+    formatsWritten_ = 0; // 新文件要能单独解码
+}
+
+// 写线程：醒来就把缓冲区写空，然后睡到下一个刷盘间隔，或者被生产者按刷盘策略提前叫醒
+void Log::AsyncWriteRing_()
+{
+    struct iovec iov[RING_BATCH];
+    while (true)
+    {
+        flushRequested_.exchange(false); // 在 Peek 之前清掉，之后才提交的行会重新置位
+        size_t n;
+        do
+        {
+            n = ring_->Peek(iov, RING_BATCH);
+            if (n > 0)
+            {
+                RotateRing_(static_cast<int>(n));
+                if (binary_)
+                {
+                    WriteFormats_();
+                }
+                WriteAll(fileno(fp_), iov, static_cast<int>(n));
+            }
+            ring_->Release();
+        } while (n > 0);
+        if (ringClosed_ && ring_->Empty())
+        {
+            break;
+        }
+
+        unique_lock<mutex> locker(ringMtx_);
+        writerSleeping_.store(true);
+        atomic_thread_fence(memory_order_seq_cst);
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(flushIntervalMs_.load(memory_order_relaxed));
+        while (!ringClosed_ && !flushRequested_ && ring_->Size() < RingFlushBytes_())
+        {
+            if (ringCond_.wait_until(locker, deadline) == cv_status::timeout)
+            {
+                break;
+            }
+        }
+        writerSleeping_.store(false, memory_order_relaxed);
+    }
 }
\ No newline at end of file
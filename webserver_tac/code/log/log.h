@@ -1,8 +1,13 @@
 #ifndef LOG_H
 #define LOG_H
 
+#include "binlog.h"
 #include "blockqueue.h"
+#include "ringbuffer.h"
 #include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <stdarg.h> // vastart va_end
 #include <string.h>
@@ -10,25 +15,75 @@
 #include <sys/stat.h> //mkdir
 #include <sys/time.h>
 #include <thread>
+#include <vector>
 
 #include "../buffer/buffer.h"
 
+// 编译期的最低日志级别(0 debug, 1 info, 2 warn, 3 error)，低于它的 LOG_ 调用整个编译掉，参数也不会求值
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
 class Log
 {
   public:
-    void init(int level, const char *path = "./log", const char *suffix = ".log", int maxQueueCapacity = 1024);
-
-    static Log *Instance();
+    // maxQueueCapacity > 0 时为异步模式；ringQueue 为 true 时用无锁环形缓冲(容量约 maxQueueCapacity 行)，
+    // 为 false 时用原来的 BlockDeque<std::string>。
+    // binary 为 true 时写二进制日志(见 binlog.h)，用 tools/log_decoder 还原成文本，只在环形缓冲模式下生效
+    void init(int level, const char *path = "./log", const char *suffix = ".log", int maxQueueCapacity = 1024,
+              bool ringQueue = true, bool binary = false);
+
+    // 懒汉模式，放在头文件里让每条 LOG_ 宏都能内联，只剩一次局部静态变量的初始化检查
+    static Log *Instance()
+    {
+        static Log inst;
+        return &inst;
+    }
     static void FlushLogThread(); // 异步写线程的调用函数
 
     void write(int level, const char *format, ...);
-    void flush();   // 刷新log文件，如果是异步，还得唤醒消费者。
+    void flush();   // 要求尽快刷盘，异步模式下只是通知写线程，不在调用线程上做文件 I/O
 
-    int GetLevel();
-    void SetLevel(int level);
+    // 刷盘策略(group commit)：积攒的日志满足任一条件才交给内核，
+    // 距上次刷盘超过 intervalMs、积攒超过 bytes 字节、或写了一行 level 及以上的日志。
+    // 异步模式下只有写线程刷盘；同步模式没有写线程，在 write 里按同样的条件刷
+    void SetFlushPolicy(int intervalMs, int bytes, int level);
+
+    // 每条 LOG_ 宏都要读一次，用 relaxed 原子变量，不加锁
+    int GetLevel()
+    {
+        return level_.load(std::memory_order_relaxed);
+    }
+    void SetLevel(int level)
+    {
+        level_.store(level, std::memory_order_relaxed);
+    }
     bool IsOpen()
     {
-        return isOpen_;
+        return isOpen_.load(std::memory_order_acquire);
+    }
+    bool IsBinary()
+    {
+        return binary_;
+    }
+
+    // 二进制模式：登记一个调用点的格式串，返回它的 id 和按格式串分析出的参数用法，每个调用点只在第一次执行时调用一次
+    binlog::Site RegisterFormat(int level, const char *file, int line, const char *format, const char *signature);
+
+    // 二进制模式：只记录格式串 id、时间戳和参数的原始字节，不做格式化
+    template <class... Args> void WriteBinary(int level, const binlog::Site &site, const Args &...args)
+    {
+        struct timeval now = {0, 0};
+        gettimeofday(&now, nullptr);
+        char *rec = BinaryBuffer_();
+        binlog::Encoder enc(rec, rec + LINE_SIZE, site.specs);
+        enc.Put<uint32_t>(0); // 总长度，最后回填
+        enc.Put<uint32_t>(site.id);
+        enc.Put<uint64_t>(now.tv_sec * 1000000ULL + now.tv_usec);
+        (enc.Arg(args), ...);
+        uint32_t len = static_cast<uint32_t>(enc.Size());
+        memcpy(rec, &len, sizeof(len));
+        PushRing_(level, rec, len);
     }
 
   private:
@@ -36,11 +91,24 @@ class Log
     void AppendLogLevelTitle_(int level);
     virtual ~Log();
     void AsyncWrite_();
+    void AsyncWriteRing_();
+    void WriteRing_(int level, const char *stamp, const char *format, va_list vaList);
+    void PushRing_(int level, const char *data, size_t len);
+    static char *BinaryBuffer_(); // 二进制记录的线程局部编码缓冲，LINE_SIZE 字节
+    void WriteFormats_();         // 写线程把当前文件还没有的格式记录补上
+    static const struct tm &FormatTime_(const struct timeval &now, char *stamp);
+    void RotateRing_(int lines); // 写线程在写出一批 lines 行之前按日期/行数切换文件
+    void WakeWriter_();
+    size_t RingFlushBytes_(); // 环形缓冲里积攒到这么多字节就叫醒写线程
 
   private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
     static const int MAX_LINES = 50000;
+    static const int LINE_SIZE = 4096;     // 单行最大长度，超出的截断
+    static const int TIME_LEN = 27;        // 行首时间 "YYYY-MM-DD HH:MM:SS.uuuuuu " 的长度
+    static const int RING_LINE_BYTES = 256; // 环形缓冲按每行这么多字节估算容量
+    static const int RING_BATCH = 256;      // 写线程一次 writev 最多写出的行数
 
     const char *path_;   // 路径名
     const char *suffix_; // 扩展名
@@ -50,30 +118,65 @@ class Log
     unsigned int lineCount_;
     int toDay_;
 
-    bool isOpen_;
+    std::atomic<bool> isOpen_; // init 打开文件、启动写线程之后才置位，其他线程看到它为 true 时 fp_ 一定可用
 
     Buffer buff_; // 缓冲区
-    int level_;     //最大日志level
+    std::atomic<int> level_; //最大日志level
     bool isAsync_;  // 是否异步
 
     FILE *fp_;
     std::unique_ptr<BlockDeque<std::string>> deque_;
     std::unique_ptr<std::thread> writeThread_;
     std::mutex mtx_;
+
+    /* 刷盘策略，见 SetFlushPolicy */
+    std::atomic<int> flushIntervalMs_;
+    std::atomic<int> flushBytes_;
+    std::atomic<int> flushLevel_;
+    std::atomic<bool> flushRequested_;                // 写了 flushLevel_ 以上的行或调用了 flush，写线程不再等攒够
+    size_t syncPending_;                              // 同步模式下还没 fflush 的字节数
+    std::chrono::steady_clock::time_point lastFlush_; // 同步模式上次 fflush 的时间
+
+    /* 无锁异步模式：各线程在线程局部缓冲里格式化好一行，放进 ring_ 就返回，不碰 mtx_；
+       写线程批量 writev 到文件，切换文件也只由写线程做 */
+    std::unique_ptr<MpscRingBuffer> ring_;
+    std::atomic<bool> writerSleeping_; // 写线程在 ringCond_ 上睡眠，生产者据此决定是否唤醒
+    std::atomic<bool> ringClosed_;
+    std::mutex ringMtx_;
+    std::condition_variable ringCond_;
+
+    /* 二进制模式 */
+    bool binary_;
+    std::mutex formatMtx_;
+    std::vector<std::string> formats_; // 下标即 id，内容是编码好的格式记录
+    size_t formatsWritten_;            // 当前文件已经写过的格式记录数，只有写线程访问
 };
 
 // 四个宏定义，主要用于不同类型的日志输出，也是外部使用日志的接口
 // ...表示可变参数，__VA_ARGS__就是将...的值复制到这里
 // 前面加上##的作用是：当可变参数的个数为0时，这里的##可以把把前面多余的","去掉,否则会编译出错。
+// 二进制模式下每个调用点用一个局部静态变量保存格式串 id，参数类型串由 decltype 在编译期推出，不求值参数。
+// level 低于 LOG_MIN_LEVEL 时 if constexpr 丢弃整个调用，只保留语法检查。
 
 #define LOG_BASE(level, format, ...)                                                                                   \
     do                                                                                                                 \
     {                                                                                                                  \
-        Log *log = Log::Instance();                                                                                    \
-        if (log->IsOpen() && log->GetLevel() <= level)                                                                 \
+        if constexpr ((level) >= LOG_MIN_LEVEL)                                                                        \
         {                                                                                                              \
-            log->write(level, format, ##__VA_ARGS__);                                                                  \
-            log->flush();                                                                                              \
+            Log *log = Log::Instance();                                                                                \
+            if (log->IsOpen() && log->GetLevel() <= level)                                                             \
+            {                                                                                                          \
+                if (log->IsBinary())                                                                                   \
+                {                                                                                                      \
+                    static const binlog::Site logSite = log->RegisterFormat(                                           \
+                        level, __FILE__, __LINE__, format, decltype(binlog::Tags(__VA_ARGS__))::Value());              \
+                    log->WriteBinary(level, logSite, ##__VA_ARGS__);                                                   \
+                }                                                                                                      \
+                else                                                                                                   \
+                {                                                                                                      \
+                    log->write(level, format, ##__VA_ARGS__);                                                          \
+                }                                                                                                      \
+            }                                                                                                          \
         }                                                                                                              \
     } while (0);
 
@@ -0,0 +1,168 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h> // iovec
+#include <vector>
+
+// 无锁的多生产者单消费者字节环形缓冲，异步日志用它代替 BlockDeque<std::string>。
+// 每条记录 = 16 字节头 + 内容，按 16 字节对齐连续存放；生产者用 CAS 抢占一段空间，拷贝内容后在头部写入提交标记，
+// 消费者从队尾开始把已提交的连续记录收集成 iovec，一次 writev 写出后再统一释放空间。
+// 放到末尾装不下的记录前面补一条填充记录，从缓冲区开头重新放，所以每条记录的内容都是连续的。
+class MpscRingBuffer
+{
+  public:
+    // capacity 向上取整到 2 的幂，单条记录最长 capacity / 4
+    explicit MpscRingBuffer(size_t capacity) : head_(0), tail_(0), peekEnd_(0)
+    {
+        size_t cap = 4096;
+        while (cap < capacity)
+        {
+            cap <<= 1;
+        }
+        cap_ = cap;
+        mask_ = cap - 1;
+        buffer_.assign(cap / sizeof(uint64_t), 0); // 全 0，提交标记都无效
+    }
+
+    size_t MaxRecord() const
+    {
+        return cap_ / 4;
+    }
+
+    size_t Capacity() const
+    {
+        return cap_;
+    }
+
+    // 已占用的字节数(含已抢占还没提交的)，只是近似值
+    size_t Size() const
+    {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+
+    // 生产者：写入一条记录，空间不够返回 false
+    bool TryPush(const char *data, size_t len)
+    {
+        assert(len <= MaxRecord());
+        size_t need = Align_(HEADER + len);
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        size_t pad;
+        while (true)
+        {
+            size_t off = head & mask_;
+            pad = off + need > cap_ ? cap_ - off : 0; // 末尾放不下，跳到开头
+            if (head + pad + need - tail_.load(std::memory_order_acquire) > cap_)
+            {
+                return false;
+            }
+            // seq_cst: Log 靠它和之后读写线程的睡眠标志配对(见 Log::PushRing_)，x86 上和 relaxed 是同一条指令
+            if (head_.compare_exchange_weak(head, head + pad + need, std::memory_order_seq_cst,
+                                            std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        if (pad)
+        {
+            Header *h = At_(head);
+            h->len = 0;
+            h->flags = FLAG_PAD;
+            __atomic_store_n(&h->stamp, head + 1, __ATOMIC_RELEASE);
+            head += pad;
+        }
+        Header *h = At_(head);
+        h->len = static_cast<uint32_t>(len);
+        h->flags = 0;
+        memcpy(h + 1, data, len);
+        __atomic_store_n(&h->stamp, head + 1, __ATOMIC_RELEASE); // 提交，消费者此后才能看到这条记录
+        return true;
+    }
+
+    // 消费者：从队尾起收集最多 maxIov 条已提交的记录，返回条数；遇到还没提交完的记录就停下，保证顺序。
+    // 收集到的内容在调用 Release 之前一直有效
+    size_t Peek(struct iovec *iov, size_t maxIov)
+    {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < maxIov)
+        {
+            Header *h = At_(pos);
+            if (__atomic_load_n(&h->stamp, __ATOMIC_ACQUIRE) != pos + 1)
+            {
+                break;
+            }
+            if (h->flags & FLAG_PAD)
+            {
+                pos += cap_ - (pos & mask_);
+                continue;
+            }
+            iov[n].iov_base = h + 1;
+            iov[n].iov_len = h->len;
+            n++;
+            pos += Align_(HEADER + h->len);
+        }
+        peekEnd_ = pos;
+        return n;
+    }
+
+    // 消费者：释放上一次 Peek 收集的记录。先把这段清零，之后在这里抢到空间的生产者写头之前，
+    // 消费者不会把残留的旧数据误认为提交标记
+    void Release()
+    {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        while (tail < peekEnd_)
+        {
+            size_t off = tail & mask_;
+            size_t len = std::min<uint64_t>(peekEnd_ - tail, cap_ - off);
+            memset(reinterpret_cast<char *>(buffer_.data()) + off, 0, len);
+            tail += len;
+        }
+        tail_.store(peekEnd_, std::memory_order_release);
+    }
+
+    // 消费者：队尾是否有已提交的记录
+    bool HasData()
+    {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        return __atomic_load_n(&At_(pos)->stamp, __ATOMIC_ACQUIRE) == pos + 1;
+    }
+
+    bool Empty()
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    struct Header
+    {
+        uint64_t stamp; // 记录的绝对位置 + 1，等于这个值才表示已提交
+        uint32_t len;
+        uint32_t flags;
+    };
+    static const size_t HEADER = sizeof(Header);
+    static const uint32_t FLAG_PAD = 1;
+
+    static size_t Align_(size_t n)
+    {
+        return (n + HEADER - 1) & ~(HEADER - 1);
+    }
+
+    Header *At_(uint64_t pos)
+    {
+        return reinterpret_cast<Header *>(reinterpret_cast<char *>(buffer_.data()) + (pos & mask_));
+    }
+
+    std::vector<uint64_t> buffer_;
+    size_t cap_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_; // 生产者抢占到的位置
+    alignas(64) std::atomic<uint64_t> tail_; // 消费者释放到的位置
+    uint64_t peekEnd_;                       // 上一次 Peek 收集到的位置，只有消费者访问
+};
+
+#endif // RINGBUFFER_H
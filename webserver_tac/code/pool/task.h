@@ -0,0 +1,141 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <assert.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 只能移动的 void() 可调用对象，替代线程池里的 std::function<void()>
+// 捕获不超过 INLINE_SIZE 字节(服务器里的 [this, client] 只有 16 字节)时直接放在对象内部，构造不分配内存；
+// 更大的捕获才退回堆上。不要求捕获可拷贝。
+class Task
+{
+  public:
+    static const size_t INLINE_SIZE = 48;
+
+    Task() noexcept : ops_(nullptr)
+    {
+    }
+
+    template <class F, class Fn = typename std::decay<F>::type,
+              class = typename std::enable_if<!std::is_same<Fn, Task>::value>::type>
+    Task(F &&f) : ops_(&OpsFor<Fn>::ops)
+    {
+        if constexpr (IsInline<Fn>())
+        {
+            new (buf_) Fn(std::forward<F>(f));
+        }
+        else
+        {
+            *reinterpret_cast<Fn **>(buf_) = new Fn(std::forward<F>(f));
+        }
+    }
+
+    Task(Task &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(buf_, other.buf_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            ops_ = other.ops_;
+            if (ops_)
+            {
+                ops_->move(buf_, other.buf_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        assert(ops_);
+        ops_->call(buf_);
+    }
+
+    explicit operator bool() const
+    {
+        return ops_ != nullptr;
+    }
+
+    void reset()
+    {
+        if (ops_)
+        {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
+        }
+    }
+
+  private:
+    struct Ops
+    {
+        void (*call)(void *);
+        void (*move)(void *dst, void *src); // 移动到 dst 并析构 src
+        void (*destroy)(void *);
+    };
+
+    template <class Fn> static constexpr bool IsInline()
+    {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template <class Fn, bool = IsInline<Fn>()> struct OpsFor
+    {
+        static void Call(void *p)
+        {
+            (*static_cast<Fn *>(p))();
+        }
+        static void Move(void *dst, void *src)
+        {
+            new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+            static_cast<Fn *>(src)->~Fn();
+        }
+        static void Destroy(void *p)
+        {
+            static_cast<Fn *>(p)->~Fn();
+        }
+        static constexpr Ops ops = {Call, Move, Destroy};
+    };
+
+    template <class Fn> struct OpsFor<Fn, false>
+    {
+        static void Call(void *p)
+        {
+            (**static_cast<Fn **>(p))();
+        }
+        static void Move(void *dst, void *src)
+        {
+            *static_cast<Fn **>(dst) = *static_cast<Fn **>(src);
+        }
+        static void Destroy(void *p)
+        {
+            delete *static_cast<Fn **>(p);
+        }
+        static constexpr Ops ops = {Call, Move, Destroy};
+    };
+
+    alignas(std::max_align_t) unsigned char buf_[INLINE_SIZE];
+    const Ops *ops_;
+};
+
+#endif // TASK_H
@@ -1,12 +1,15 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
+#include <algorithm>
 #include <assert.h>
 #include <condition_variable>
-#include <functional>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
+
+#include "task.h"
 
 class ThreadPool
 {
@@ -31,7 +34,11 @@ class ThreadPool
                     else if (pool->isClosed)
                         break;
                     else
+                    {
+                        pool->idle++;
                         pool->cond.wait(locker); // 线程阻塞等待被唤醒
+                        pool->idle--;
+                    }
                 }
             })
                 .detach();
@@ -63,13 +70,45 @@ class ThreadPool
         pool_->cond.notify_one(); // 唤醒一个线程
     }
 
+    // 一次加锁提交一批任务，只唤醒 min(任务数, 睡眠线程数) 个线程；提交后 tasks 被清空，容量保留下来复用
+    void AddTasks(std::vector<Task> &tasks)
+    {
+        if (tasks.empty())
+        {
+            return;
+        }
+        size_t idle, wake;
+        {
+            std::lock_guard<std::mutex> locker(pool_->mtx);
+            for (auto &task : tasks)
+            {
+                pool_->tasks.push(std::move(task));
+            }
+            idle = pool_->idle;
+            wake = std::min(tasks.size(), idle);
+        }
+        tasks.clear();
+        if (wake > 0 && wake == idle)
+        {
+            pool_->cond.notify_all();
+        }
+        else
+        {
+            while (wake-- > 0)
+            {
+                pool_->cond.notify_one();
+            }
+        }
+    }
+
   private:
     struct Pool
     {
         std::mutex mtx;                          // 创建锁
         std::condition_variable cond;            // 创建条件变量
         bool isClosed = false;                   // 判断是否关闭线程
-        std::queue<std::function<void()>> tasks; // 请求任务队列
+        size_t idle = 0;                         // 在 cond 上等待的线程数
+        std::queue<Task> tasks;                  // 请求任务队列，Task 只能移动、小捕获不分配内存
     };
     std::shared_ptr<Pool> pool_;
 };
@@ -0,0 +1,621 @@
+#ifndef WORKSTEALPOOL_H
+#define WORKSTEALPOOL_H
+
+#include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "task.h"
+
+// Chase-Lev 无锁双端队列，容量固定为 2 的幂
+// 只有所属线程从底部 Push/Pop，其他线程从顶部 Steal；满了 Push 返回 false，由调用者放到全局队列
+template <class T> class WorkStealingDeque
+{
+  public:
+    explicit WorkStealingDeque(size_t capacity = 256)
+        : top_(0), bottom_(0), mask_(capacity - 1), buf_(new std::atomic<T *>[capacity])
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    bool Push(T *item)
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t > static_cast<int64_t>(mask_))
+        {
+            return false;
+        }
+        buf_[b & mask_].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    T *Pop()
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom_.store(b + 1, std::memory_order_relaxed); // 空
+            return nullptr;
+        }
+        T *item = buf_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            /* 最后一个元素，和偷取者抢 top_ */
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    T *Steal()
+    {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return nullptr;
+        }
+        T *item = buf_[t & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr; // 被别人抢走了
+        }
+        return item;
+    }
+
+    bool Empty() const
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+    size_t Size() const
+    {
+        int64_t n = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+        return n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+  private:
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    size_t mask_;
+    std::unique_ptr<std::atomic<T *>[]> buf_;
+};
+
+// 工作窃取线程池，AddTask 与 ThreadPool 相同
+// 每个工作线程有自己的 Chase-Lev 队列，工作线程里提交的任务进自己的队列；
+// 反应堆线程等外部线程提交的任务进全局注入队列，工作线程一次从中取一批，余下的放进自己的队列供别人偷。
+// 找不到任务时先自旋 SPIN_ROUNDS 轮(期间反复偷取)再睡眠，提交时只有存在睡眠线程才 notify。
+// AddTasks 把一次 epoll_wait 得到的任务一起提交，一次加锁，按任务数唤醒。
+// 任务结点在构造时一次分配 NODE_COUNT 个，用带版本号的无锁栈回收复用；任务本身是内联存储的 Task，
+// 全局队列是串在结点上的侵入式链表，所以提交不会调用 malloc。结点用完时才临时 new。
+// affine 为 true 时是连接亲和模式：带 key 提交的任务固定进第 key % 线程数 个工作线程的收件箱，不参与偷取，
+// 同一连接的事件总在同一个线程上执行；QueueDepth 给出各队列积压的任务数，用来观察负载是否均衡。
+class WorkStealingPool
+{
+  public:
+    explicit WorkStealingPool(size_t threadCount = 8, bool affine = false)
+        : pool_(std::make_shared<Pool>(threadCount, affine))
+    {
+        assert(threadCount > 0);
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            std::thread([pool = pool_, i] { pool->Run(i); }).detach();
+        }
+    }
+
+    WorkStealingPool() = default;
+
+    WorkStealingPool(WorkStealingPool &&) = default;
+
+    ~WorkStealingPool()
+    {
+        if (static_cast<bool>(pool_))
+        {
+            pool_->Close();
+        }
+    }
+
+    template <class F> void AddTask(F &&task)
+    {
+        Node *node = pool_->AllocNode();
+        node->fn = Task(std::forward<F>(task));
+        if (pool_->affine)
+        {
+            pool_->PushAffine(pool_->NextKey(), node);
+        }
+        else
+        {
+            pool_->Submit(node);
+        }
+    }
+
+    // 亲和模式下按 key(一般是连接的 fd)选工作线程，否则与 AddTask 相同
+    template <class F> void AddTask(size_t key, F &&task)
+    {
+        Node *node = pool_->AllocNode();
+        node->fn = Task(std::forward<F>(task));
+        if (pool_->affine)
+        {
+            pool_->PushAffine(key, node);
+        }
+        else
+        {
+            pool_->Submit(node);
+        }
+    }
+
+    // 一批任务串成链表后一次加锁挂到全局队列，只唤醒 min(任务数, 睡眠线程数) 个线程；
+    // 提交后 tasks 被清空，容量保留下来复用
+    void AddTasks(std::vector<Task> &tasks)
+    {
+        if (tasks.empty())
+        {
+            return;
+        }
+        if (pool_->affine)
+        {
+            for (auto &task : tasks)
+            {
+                Node *node = pool_->AllocNode();
+                node->fn = std::move(task);
+                pool_->PushAffine(pool_->NextKey(), node);
+            }
+            tasks.clear();
+            return;
+        }
+        Node *head = nullptr;
+        Node *tail = nullptr;
+        for (auto &task : tasks)
+        {
+            Node *node = pool_->AllocNode();
+            node->fn = std::move(task);
+            node->next = nullptr;
+            if (tail)
+            {
+                tail->next = node;
+            }
+            else
+            {
+                head = node;
+            }
+            tail = node;
+        }
+        pool_->Inject(head, tail, tasks.size());
+        tasks.clear();
+    }
+
+    // 带 key 的批量提交，keys[i] 对应 tasks[i]；每个收件箱一批里最多 notify 一次。提交后两者都被清空
+    template <class Key> void AddTasks(std::vector<Task> &tasks, std::vector<Key> &keys)
+    {
+        assert(tasks.size() == keys.size());
+        if (pool_->affine)
+        {
+            for (size_t i = 0; i < tasks.size(); i++)
+            {
+                Node *node = pool_->AllocNode();
+                node->fn = std::move(tasks[i]);
+                pool_->PushAffine(static_cast<size_t>(keys[i]), node);
+            }
+            tasks.clear();
+        }
+        else
+        {
+            AddTasks(tasks);
+        }
+        keys.clear();
+    }
+
+    size_t QueueCount() const
+    {
+        return pool_->workers.size();
+    }
+
+    // 第 i 个工作线程队列里等待执行的任务数，亲和模式下是收件箱，否则是本地的偷取队列
+    size_t QueueDepth(size_t i) const
+    {
+        const Worker &w = pool_->workers[i];
+        return pool_->affine ? w.depth.load(std::memory_order_relaxed) : w.deque.Size();
+    }
+
+    // 亲和模式下第 i 个收件箱出现过的最大积压
+    size_t MaxQueueDepth(size_t i) const
+    {
+        return pool_->workers[i].maxDepth.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Node
+    {
+        Task fn;
+        Node *next;                     // 全局队列中的下一个
+        std::atomic<uint32_t> freeNext; // 空闲栈中的下一个下标
+        bool pooled;                    // 是否在预分配的数组里
+    };
+
+    struct Worker
+    {
+        WorkStealingDeque<Node> deque;
+        uint32_t seed; // 选偷取对象用的随机数状态
+
+        /* 亲和模式的收件箱 */
+        std::mutex mtx;
+        std::condition_variable cond;
+        Node *head = nullptr;
+        Node *tail = nullptr;
+        bool sleeping = false; // 正在 cond 上等待
+        bool signaled = false; // 已经 notify 过，还没醒
+        std::atomic<size_t> depth{0};
+        std::atomic<size_t> maxDepth{0};
+    };
+
+    struct Pool
+    {
+        static const int SPIN_ROUNDS = 64;  // 睡眠前的自旋轮数
+        static const size_t INJECT_BATCH = 32; // 每次从全局队列取的最多任务数
+        static const uint32_t NODE_COUNT = 1 << 16; // 预分配的结点数
+        static const uint32_t NIL = UINT32_MAX;
+
+        Pool(size_t n, bool affine) : affine(affine), workers(n), nodes(new Node[NODE_COUNT]), freeHead(0)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                workers[i].seed = static_cast<uint32_t>(i * 2654435761u + 1);
+            }
+            for (uint32_t i = 0; i < NODE_COUNT; i++)
+            {
+                nodes[i].pooled = true;
+                nodes[i].freeNext.store(i + 1 < NODE_COUNT ? i + 1 : NIL, std::memory_order_relaxed);
+            }
+        }
+
+        ~Pool()
+        {
+            while (injectHead)
+            {
+                Node *node = injectHead;
+                injectHead = node->next;
+                FreeNode(node);
+            }
+            for (auto &w : workers)
+            {
+                while (Node *node = w.deque.Pop())
+                {
+                    FreeNode(node);
+                }
+                while (w.head)
+                {
+                    Node *node = w.head;
+                    w.head = node->next;
+                    FreeNode(node);
+                }
+            }
+        }
+
+        void Close()
+        {
+            {
+                std::lock_guard<std::mutex> locker(parkMtx);
+                isClosed = true;
+            }
+            parkCond.notify_all();
+            for (auto &w : workers)
+            {
+                { std::lock_guard<std::mutex> locker(w.mtx); }
+                w.cond.notify_all();
+            }
+        }
+
+        /* 没有 key 的任务：工作线程提交的留在本线程，外部提交的轮流分配 */
+        size_t NextKey()
+        {
+            Current *self = current;
+            if (self && self->owner == this)
+            {
+                return self->index;
+            }
+            return nextKey.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void PushAffine(size_t key, Node *node)
+        {
+            Worker &w = workers[key % workers.size()];
+            node->next = nullptr;
+            bool wake = false;
+            {
+                std::lock_guard<std::mutex> locker(w.mtx);
+                if (w.tail)
+                {
+                    w.tail->next = node;
+                }
+                else
+                {
+                    w.head = node;
+                }
+                w.tail = node;
+                size_t depth = w.depth.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (depth > w.maxDepth.load(std::memory_order_relaxed))
+                {
+                    w.maxDepth.store(depth, std::memory_order_relaxed);
+                }
+                if (w.sleeping && !w.signaled)
+                {
+                    w.signaled = true;
+                    wake = true;
+                }
+            }
+            if (wake)
+            {
+                w.cond.notify_one();
+            }
+        }
+
+        /* freeHead 高 32 位是版本号，低 32 位是栈顶下标，版本号防止 ABA */
+        Node *AllocNode()
+        {
+            uint64_t head = freeHead.load(std::memory_order_acquire);
+            while (true)
+            {
+                uint32_t idx = static_cast<uint32_t>(head);
+                if (idx == NIL)
+                {
+                    Node *node = new Node();
+                    node->pooled = false;
+                    return node;
+                }
+                uint64_t next = ((head >> 32) + 1) << 32 | nodes[idx].freeNext.load(std::memory_order_relaxed);
+                if (freeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    return &nodes[idx];
+                }
+            }
+        }
+
+        void FreeNode(Node *node)
+        {
+            node->fn.reset();
+            if (!node->pooled)
+            {
+                delete node;
+                return;
+            }
+            uint32_t idx = static_cast<uint32_t>(node - nodes.get());
+            uint64_t head = freeHead.load(std::memory_order_relaxed);
+            do
+            {
+                node->freeNext.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            } while (!freeHead.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | idx, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+        }
+
+        void Submit(Node *node)
+        {
+            Current *self = current;
+            if (!self || self->owner != this || !workers[self->index].deque.Push(node))
+            {
+                node->next = nullptr;
+                Inject(node, node, 1);
+                return;
+            }
+            pending.fetch_add(1, std::memory_order_seq_cst);
+            Wake(1);
+        }
+
+        void Inject(Node *head, Node *tail, size_t n)
+        {
+            {
+                std::lock_guard<std::mutex> locker(injectMtx);
+                if (injectTail)
+                {
+                    injectTail->next = head;
+                }
+                else
+                {
+                    injectHead = head;
+                }
+                injectTail = tail;
+            }
+            pending.fetch_add(n, std::memory_order_seq_cst);
+            Wake(n);
+        }
+
+        void Wake(size_t n)
+        {
+            size_t sleepers = idle.load(std::memory_order_seq_cst);
+            if (sleepers == 0)
+            {
+                return;
+            }
+            /* 加锁保证睡眠线程已经进入 wait，避免丢失唤醒 */
+            { std::lock_guard<std::mutex> locker(parkMtx); }
+            if (n >= sleepers)
+            {
+                parkCond.notify_all();
+                return;
+            }
+            while (n-- > 0)
+            {
+                parkCond.notify_one();
+            }
+        }
+
+        Node *TakeInjected(Worker &self)
+        {
+            if (pending.load(std::memory_order_relaxed) == 0)
+            {
+                return nullptr;
+            }
+            std::lock_guard<std::mutex> locker(injectMtx);
+            Node *node = injectHead;
+            if (!node)
+            {
+                return nullptr;
+            }
+            injectHead = node->next;
+            for (size_t n = 1; n < INJECT_BATCH && injectHead; n++)
+            {
+                if (!self.deque.Push(injectHead))
+                {
+                    break;
+                }
+                injectHead = injectHead->next;
+            }
+            if (!injectHead)
+            {
+                injectTail = nullptr;
+            }
+            return node;
+        }
+
+        Node *StealOther(Worker &self, size_t index)
+        {
+            size_t n = workers.size();
+            self.seed ^= self.seed << 13;
+            self.seed ^= self.seed >> 17;
+            self.seed ^= self.seed << 5;
+            size_t start = self.seed % n;
+            for (size_t k = 0; k < n; k++)
+            {
+                size_t victim = (start + k) % n;
+                if (victim == index)
+                {
+                    continue;
+                }
+                if (Node *task = workers[victim].deque.Steal())
+                {
+                    return task;
+                }
+            }
+            return nullptr;
+        }
+
+        Node *Find(Worker &self, size_t index)
+        {
+            Node *task = self.deque.Pop();
+            if (!task)
+            {
+                task = TakeInjected(self);
+            }
+            if (!task)
+            {
+                task = StealOther(self, index);
+            }
+            return task;
+        }
+
+        /* 亲和模式：每次把收件箱整个摘下来依次执行，空了先自旋再睡在自己的 cond 上 */
+        void RunAffine(Worker &self)
+        {
+            while (true)
+            {
+                for (int spin = 0; spin < SPIN_ROUNDS && self.depth.load(std::memory_order_relaxed) == 0 && !isClosed;
+                     spin++)
+                {
+                    std::this_thread::yield();
+                }
+                Node *list;
+                {
+                    std::unique_lock<std::mutex> locker(self.mtx);
+                    self.sleeping = true;
+                    self.cond.wait(locker, [&] { return self.head || isClosed; });
+                    self.sleeping = false;
+                    self.signaled = false;
+                    list = self.head;
+                    self.head = self.tail = nullptr;
+                }
+                if (!list)
+                {
+                    break; // 关闭且已经没有任务
+                }
+                while (list)
+                {
+                    Node *next = list->next;
+                    self.depth.fetch_sub(1, std::memory_order_relaxed);
+                    list->fn();
+                    FreeNode(list);
+                    list = next;
+                }
+            }
+        }
+
+        void Run(size_t index)
+        {
+            Worker &self = workers[index];
+            Current me{this, index};
+            current = &me;
+            if (affine)
+            {
+                RunAffine(self);
+                current = nullptr;
+                return;
+            }
+            while (true)
+            {
+                Node *task = nullptr;
+                for (int spin = 0; spin < SPIN_ROUNDS && !task; spin++)
+                {
+                    task = Find(self, index);
+                    if (!task)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                if (task)
+                {
+                    pending.fetch_sub(1, std::memory_order_relaxed);
+                    task->fn();
+                    FreeNode(task);
+                    continue;
+                }
+                /* 自旋也没找到，登记为空闲后睡眠，直到有新任务或关闭 */
+                std::unique_lock<std::mutex> locker(parkMtx);
+                idle.fetch_add(1, std::memory_order_seq_cst);
+                parkCond.wait(locker, [this] { return pending.load(std::memory_order_seq_cst) > 0 || isClosed; });
+                idle.fetch_sub(1, std::memory_order_relaxed);
+                if (isClosed && pending.load(std::memory_order_seq_cst) == 0)
+                {
+                    break;
+                }
+            }
+            current = nullptr;
+        }
+
+        struct Current
+        {
+            Pool *owner;
+            size_t index;
+        };
+        static inline thread_local Current *current = nullptr; // 当前线程所属的池和下标，外部线程为空
+
+        const bool affine;
+        std::vector<Worker> workers;
+        std::atomic<size_t> nextKey{0};
+        std::unique_ptr<Node[]> nodes;
+        std::atomic<uint64_t> freeHead;
+        std::mutex injectMtx;
+        Node *injectHead = nullptr; // 全局注入队列
+        Node *injectTail = nullptr;
+        std::atomic<long> pending{0}; // 已提交还没被取走的任务数
+        std::atomic<int> idle{0};     // 睡眠中的线程数
+        std::mutex parkMtx;
+        std::condition_variable parkCond;
+        std::atomic<bool> isClosed{false};
+    };
+    std::shared_ptr<Pool> pool_;
+};
+
+#endif // WORKSTEALPOOL_H
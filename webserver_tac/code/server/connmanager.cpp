@@ -0,0 +1,131 @@
+#include "connmanager.h"
+
+ConnManager::ConnManager(Epoller *epoller, int timeoutMS, uint32_t connEvent, int lazyTickMS)
+    : epoller_(epoller), timeoutMS_(timeoutMS), connEvent_(connEvent), lazyTickMS_(timeoutMS > 0 ? lazyTickMS : 0),
+      timerFd_(-1), nowMS_(0), timer_(new TimeWheel())
+{
+    assert(epoller_);
+    if (lazyTickMS_ > 0)
+    {
+        timerFd_ = epoller_->AddTimer(lazyTickMS_);
+        if (timerFd_ < 0)
+        {
+            LOG_WARN("timerfd create failed, fall back to exact timeout!");
+            lazyTickMS_ = 0;
+        }
+    }
+}
+
+int ConnManager::WaitTimeout()
+{
+    if (timeoutMS_ > 0 && lazyTickMS_ == 0)
+    {
+        return timer_->GetNextTick();
+    }
+    return -1; /* 无事件将阻塞，惰性模式下由 timerfd 唤醒 */
+}
+
+void ConnManager::UpdateNow()
+{
+    if (lazyTickMS_ > 0)
+    {
+        nowMS_ = std::chrono::duration_cast<MS>(Clock::now().time_since_epoch()).count();
+    }
+}
+
+void ConnManager::Tick()
+{
+    /* 惰性模式的定时扫描，到期的连接成批处理 */
+    Epoller::ReadTimer(timerFd_);
+    timer_->tick();
+}
+
+void ConnManager::Add(int fd, const sockaddr_in &addr)
+{
+    assert(fd > 0);
+    users_[fd].init(fd, addr);
+    char ip[24] = {0};
+    LOG_INFO("Connect from %s", inet_ntop(AF_INET, &addr.sin_addr.s_addr, ip, sizeof(ip)));
+    if (timeoutMS_ > 0)
+    {
+        // 将新连接添加到定时器中
+        users_[fd].SetActive(nowMS_);
+        timer_->add(fd, timeoutMS_, [this, capture0 = &users_[fd]] { OnTimeout_(capture0); });
+    }
+    epoller_->AddFd(fd, EPOLLIN | connEvent_);
+}
+
+void ConnManager::Close(HttpConn *client)
+{
+    assert(client);
+    LOG_INFO("Client[%d] quit!", client->GetFd());
+    epoller_->DelFd(client->GetFd());
+    client->Close();
+}
+
+void ConnManager::Extend(HttpConn *client)
+{
+    assert(client);
+    // 当连接有新的事件时更新定时器，惰性模式下只记录活跃时间
+    if (lazyTickMS_ > 0)
+    {
+        client->SetActive(nowMS_);
+    }
+    else if (timeoutMS_ > 0)
+    {
+        timer_->adjust(client->GetFd(), timeoutMS_);
+    }
+}
+
+void ConnManager::OnTimeout_(HttpConn *client)
+{
+    assert(client);
+    if (lazyTickMS_ > 0)
+    {
+        int64_t idle = nowMS_ - client->LastActive();
+        if (idle < timeoutMS_)
+        {
+            /* 期间有过 I/O，按剩余的空闲时间重新挂上 */
+            timer_->add(client->GetFd(), static_cast<int>(timeoutMS_ - idle),
+                        [this, client] { OnTimeout_(client); });
+            return;
+        }
+    }
+    Close(client);
+}
+
+bool ConnManager::Read(HttpConn *client)
+{
+    assert(client);
+    int readErrno = 0;
+    ssize_t ret = client->read(&readErrno);
+    if (ret <= 0 && readErrno != EAGAIN)
+    {
+        Close(client);
+        return false;
+    }
+    return true;
+}
+
+bool ConnManager::Write(HttpConn *client)
+{
+    assert(client);
+    int writeErrno = 0;
+    ssize_t ret = client->write(&writeErrno);
+    if (client->ToWriteBytes() == 0)
+    {
+        /* 传输完成 */
+        if (client->IsKeepAlive())
+        {
+            return true;
+        }
+    }
+    else if (ret > 0 || writeErrno == EAGAIN)
+    {
+        /* 写缓冲区满了(或LT模式下单次未写完)，等待可写事件继续传输 */
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        return false;
+    }
+    Close(client);
+    return false;
+}
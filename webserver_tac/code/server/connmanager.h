@@ -0,0 +1,89 @@
+#ifndef CONNMANAGER_H
+#define CONNMANAGER_H
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <sys/socket.h> // accept4()
+#include <unistd.h>     // close()
+#include <unordered_map>
+
+#include "../http/http_connect.h"
+#include "../log/log.h"
+#include "../timer/timewheel.h"
+#include "epoller.h"
+
+// 一个事件循环的连接表、超时定时器和读写收尾，WebServer 的单 Reactor 模式和每个 SubReactor 各持有一个。
+// 连接表和定时器只在事件循环线程里访问；Read/Write/Close 只动单个连接，可以在工作线程里调用。
+class ConnManager
+{
+  public:
+    // lazyTickMS > 0 时使用惰性超时: I/O 只记录活跃时间，由 timerfd 周期性驱动时间轮；timerfd 创建失败时退回精确超时
+    ConnManager(Epoller *epoller, int timeoutMS, uint32_t connEvent, int lazyTickMS = 0);
+
+    // 接受 listenFd 上的新连接(非阻塞)交给 onAccept，ET 模式下一直接受到队列为空；连接数已满时回绝并返回
+    template <class F> static void Accept(int listenFd, uint32_t listenEvent, F &&onAccept)
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        do
+        {
+            int fd = accept4(listenFd, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK);
+            if (fd <= 0)
+            {
+                return;
+            }
+            else if (HttpConn::userCount >= MAX_FD)
+            {
+                const char *info = "Server busy!";
+                send(fd, info, strlen(info), 0);
+                close(fd);
+                LOG_WARN("Clients is full!");
+                return;
+            }
+            onAccept(fd, addr);
+        } while (listenEvent & EPOLLET);
+    }
+
+    int TimerFd() const
+    {
+        return timerFd_;
+    }
+
+    int WaitTimeout();   // epoll_wait 的超时: 精确模式下为时间轮下一次到期的时间，否则 -1
+    void UpdateNow();    // epoll_wait 返回后调用，惰性模式下刷新本轮的时间戳
+    void Tick();         // timerFd 可读时调用，驱动时间轮
+
+    HttpConn *Get(int fd)
+    {
+        assert(users_.count(fd) > 0);
+        return &users_[fd];
+    }
+
+    void Add(int fd, const sockaddr_in &addr); // 初始化连接、挂上定时器并注册 EPOLLIN
+    void Close(HttpConn *client);
+    void Extend(HttpConn *client); // 连接有新事件时推迟超时
+
+    bool Read(HttpConn *client);  // 读出错或对端关闭时关掉连接并返回 false
+    bool Write(HttpConn *client); // 响应写完且 keep-alive 时返回 true，由调用方继续处理下一个请求；
+                                  // 没写完时注册 EPOLLOUT，其余情况关掉连接，都返回 false
+
+    static const int MAX_FD = 65536;
+
+  private:
+    void OnTimeout_(HttpConn *client);
+
+    Epoller *epoller_;
+    int timeoutMS_; /* 毫秒MS */
+    uint32_t connEvent_;
+    int lazyTickMS_;
+    int timerFd_;
+    int64_t nowMS_; // 本轮事件循环的时间，惰性模式下用作活跃时间戳
+
+    std::unordered_map<int, HttpConn> users_;
+    std::unique_ptr<TimeWheel> timer_;
+};
+
+#endif // CONNMANAGER_H
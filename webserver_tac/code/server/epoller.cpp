@@ -5,6 +5,9 @@ Epoller::Epoller(int maxEvent):epollFd_(epoll_create(512)), events_(maxEvent){
 }
 
 Epoller::~Epoller() {
+    for(int fd : timerFds_) {
+        close(fd);
+    }
     close(epollFd_);
 }
 
@@ -42,4 +45,26 @@ int Epoller::GetEventFd(size_t i) const {
 uint32_t Epoller::GetEvents(size_t i) const {
     assert(i < events_.size() && i >= 0);
     return events_[i].events;
+}
+
+int Epoller::AddTimer(int intervalMs) {
+    assert(intervalMs > 0);
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(fd < 0) return -1;
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = intervalMs / 1000;
+    spec.it_interval.tv_nsec = (intervalMs % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if(timerfd_settime(fd, 0, &spec, nullptr) < 0 || !AddFd(fd, EPOLLIN)) {
+        close(fd);
+        return -1;
+    }
+    timerFds_.push_back(fd);
+    return fd;
+}
+
+uint64_t Epoller::ReadTimer(int fd) {
+    uint64_t cnt = 0;
+    ssize_t ret = read(fd, &cnt, sizeof(cnt));
+    return ret == sizeof(cnt) ? cnt : 0;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <assert.h> // close()
 #include <vector>
 #include <errno.h>
+#include <sys/timerfd.h> // timerfd_create()
 
 class Epoller {
 public:
@@ -25,9 +26,16 @@ public:
     int GetEventFd(size_t i) const;
 
     uint32_t GetEvents(size_t i) const;
+
+    // 创建周期为 intervalMs 的 timerfd 并注册可读事件，返回其 fd，由 Epoller 负责关闭
+    int AddTimer(int intervalMs);
+
+    // 读掉 timerfd 的计数，返回自上次读取以来到期的次数
+    static uint64_t ReadTimer(int fd);
         
 private:
     int epollFd_;
+    std::vector<int> timerFds_;
 
     std::vector<struct epoll_event> events_;    
 };
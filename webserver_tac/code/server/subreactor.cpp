@@ -0,0 +1,166 @@
+#include "subreactor.h"
+
+SubReactor::SubReactor(int timeoutMS, uint32_t connEvent, int lazyTickMS)
+    : connEvent_(connEvent), listenFd_(-1), listenEvent_(0), isClose_(false),
+      wakeupFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), epoller_(new Epoller()),
+      conns_(new ConnManager(epoller_.get(), timeoutMS, connEvent, lazyTickMS))
+{
+    assert(wakeupFd_ >= 0);
+    epoller_->AddFd(wakeupFd_, EPOLLIN);
+}
+
+SubReactor::~SubReactor()
+{
+    Stop();
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        for (auto &item : pending_)
+        {
+            close(item.first);
+        }
+        pending_.clear();
+    }
+    if (listenFd_ >= 0)
+    {
+        close(listenFd_);
+    }
+    close(wakeupFd_);
+}
+
+void SubReactor::Start(int cpu)
+{
+    assert(!thread_.joinable());
+    thread_ = std::thread([this] { Loop_(); });
+    if (cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        if (pthread_setaffinity_np(thread_.native_handle(), sizeof(cpuset), &cpuset) != 0)
+        {
+            LOG_WARN("SubReactor pin to cpu %d failed!", cpu);
+        }
+    }
+}
+
+void SubReactor::SetListenFd(int listenFd, uint32_t listenEvent)
+{
+    assert(listenFd >= 0 && listenFd_ < 0 && !thread_.joinable());
+    listenFd_ = listenFd;
+    listenEvent_ = listenEvent;
+    epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN);
+}
+
+void SubReactor::Stop()
+{
+    isClose_ = true;
+    uint64_t one = 1;
+    ssize_t ret = ::write(wakeupFd_, &one, sizeof(one));
+    (void)ret;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void SubReactor::AddClient(int fd, const sockaddr_in &addr)
+{
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        pending_.emplace_back(fd, addr);
+    }
+    // 写 eventfd 唤醒本 Reactor 的 epoll_wait
+    uint64_t one = 1;
+    ssize_t ret = ::write(wakeupFd_, &one, sizeof(one));
+    (void)ret;
+}
+
+void SubReactor::Loop_()
+{
+    while (!isClose_)
+    {
+        int eventCnt = epoller_->Wait(conns_->WaitTimeout());
+        conns_->UpdateNow();
+        for (int i = 0; i < eventCnt; i++)
+        {
+            int fd = epoller_->GetEventFd(i);
+            uint32_t events = epoller_->GetEvents(i);
+            if (fd == listenFd_)
+            {
+                ConnManager::Accept(listenFd_, listenEvent_,
+                                    [this](int fd, const sockaddr_in &addr) { conns_->Add(fd, addr); });
+            }
+            else if (fd == wakeupFd_)
+            {
+                HandleWakeup_();
+            }
+            else if (fd == conns_->TimerFd())
+            {
+                conns_->Tick();
+            }
+            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                conns_->Close(conns_->Get(fd));
+            }
+            else if (events & EPOLLIN)
+            {
+                DealRead_(conns_->Get(fd));
+            }
+            else if (events & EPOLLOUT)
+            {
+                DealWrite_(conns_->Get(fd));
+            }
+        }
+    }
+}
+
+void SubReactor::HandleWakeup_()
+{
+    uint64_t cnt = 0;
+    ssize_t ret = ::read(wakeupFd_, &cnt, sizeof(cnt));
+    (void)ret;
+
+    // 交换出来再注册，避免持锁期间做系统调用
+    std::vector<std::pair<int, sockaddr_in>> pending;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        pending.swap(pending_);
+    }
+    for (auto &item : pending)
+    {
+        conns_->Add(item.first, item.second);
+    }
+}
+
+void SubReactor::DealRead_(HttpConn *client)
+{
+    assert(client);
+    conns_->Extend(client);
+    if (conns_->Read(client))
+    {
+        OnProcess_(client);
+    }
+}
+
+void SubReactor::OnProcess_(HttpConn *client)
+{
+    if (client->process())
+    {
+        // 本线程独占该连接，响应生成后直接尝试发送，省掉一次 EPOLLOUT 往返
+        DealWrite_(client);
+    }
+    else
+    {
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+    }
+}
+
+void SubReactor::DealWrite_(HttpConn *client)
+{
+    assert(client);
+    conns_->Extend(client);
+    if (conns_->Write(client))
+    {
+        OnProcess_(client);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SUBREACTOR_H
+#define SUBREACTOR_H
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <pthread.h>     // pthread_setaffinity_np()
+#include <sys/eventfd.h> // eventfd()
+#include <thread>
+#include <unistd.h> // close()
+#include <utility>
+#include <vector>
+
+#include "connmanager.h"
+#include "epoller.h"
+
+// one loop per thread 模式下的从 Reactor
+// 主 Reactor 只负责 accept，把新连接交给从 Reactor；
+// 每个从 Reactor 拥有自己的 Epoller 和 ConnManager(连接表、定时器)，读写和 process 都在本线程内联完成，不再经过线程池。
+// SO_REUSEPORT 分片模式下，从 Reactor 还拥有自己的监听套接字，直接 accept 到自己的事件循环里。
+class SubReactor
+{
+  public:
+    // lazyTickMS > 0 时使用惰性超时: I/O 只记录活跃时间，由 timerfd 周期性驱动时间轮
+    SubReactor(int timeoutMS, uint32_t connEvent, int lazyTickMS = 0);
+
+    ~SubReactor();
+
+    void Start(int cpu = -1); // 启动事件循环线程，cpu >= 0 时把线程绑定到该 CPU
+    void Stop();              // 通知事件循环退出并等待线程结束
+
+    void SetListenFd(int listenFd, uint32_t listenEvent); // 分片模式: 接管一个监听套接字，须在 Start 之前调用
+
+    void AddClient(int fd, const sockaddr_in &addr); // 由主 Reactor 线程调用，投递新连接
+
+  private:
+    void Loop_();
+    void HandleWakeup_();
+
+    void DealRead_(HttpConn *client);
+    void DealWrite_(HttpConn *client);
+    void OnProcess_(HttpConn *client);
+
+    uint32_t connEvent_;
+    int listenFd_; // 非分片模式下为 -1
+    uint32_t listenEvent_;
+    std::atomic<bool> isClose_;
+
+    int wakeupFd_; // eventfd, 有新连接或需要退出时唤醒 epoll_wait
+
+    std::mutex mtx_;                                       // 保护 pending_
+    std::vector<std::pair<int, sockaddr_in>> pending_;     // 主 Reactor 投递过来、尚未注册的连接
+
+    std::unique_ptr<Epoller> epoller_;
+    std::unique_ptr<ConnManager> conns_;
+    std::thread thread_;
+};
+
+#endif // SUBREACTOR_H
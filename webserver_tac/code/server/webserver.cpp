@@ -2,9 +2,13 @@
 
 WebServer::WebServer(int port, int trigMode, int timeoutMS, bool OptLinger, int sqlPort, const char *sqlUser,
                      const char *sqlPwd, const char *dbName, int connPoolNum, int threadNum, bool openLog, int logLevel,
-                     int logQueSize)
-    : port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false), timer_(new HeapTimer()),
-      threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+                     int logQueSize, int subReactorNum, bool reusePort, int backlog, bool pinCpu, int lazyTickMS, bool affineDispatch)
+    : port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false), listenFd_(-1),
+      reusePort_(reusePort && subReactorNum > 0), backlog_(backlog), pinCpu_(pinCpu),
+      affineDispatch_(affineDispatch),
+      lazyTickMS_(timeoutMS > 0 ? lazyTickMS : 0), epoller_(new Epoller()),
+      threadpool_(new WorkStealingPool(threadNum, affineDispatch)), verifyPool_(new ThreadPool(std::max(connPoolNum, 1))),
+      nextReactor_(0)
 {
 
     srcDir_ = new char[256];
@@ -23,10 +27,25 @@ WebServer::WebServer(int port, int trigMode, int timeoutMS, bool OptLinger, int
         LOG_INFO("LogSys level: %d", logLevel);
         LOG_INFO("srcDir: %s", HttpConn::srcDir);
         LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+        LOG_INFO("SubReactor num: %d, ReusePort: %s, Backlog: %d, PinCpu: %s", subReactorNum,
+                 reusePort_ ? "true" : "false", backlog_, pinCpu_ ? "true" : "false");
+        LOG_INFO("Timeout: %dms, Lazy tick: %dms", timeoutMS_, lazyTickMS_);
+        LOG_INFO("Affine dispatch: %s", affineDispatch ? "true" : "false");
     }
 
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
     InitEventMode_(trigMode);
+    batch_.reserve(1024); // 与 Epoller 一次最多返回的事件数相同，之后提交不再扩容
+    batchKeys_.reserve(1024);
+    for (int i = 0; i < subReactorNum; i++)
+    {
+        // 从 Reactor 独占连接，不需要 EPOLLONESHOT
+        subReactors_.emplace_back(new SubReactor(timeoutMS_, connEvent_ & ~EPOLLONESHOT, lazyTickMS_));
+    }
+    if (subReactors_.empty())
+    {
+        conns_.reset(new ConnManager(epoller_.get(), timeoutMS_, connEvent_, lazyTickMS_));
+    }
     if (!InitSocket_())
     {
         isClose_ = true;
@@ -36,7 +55,15 @@ WebServer::WebServer(int port, int trigMode, int timeoutMS, bool OptLinger, int
 
 WebServer::~WebServer()
 {
-    close(listenFd_);
+    if (affineDispatch_)
+    {
+        LogQueueDepth_();
+    }
+    subReactors_.clear(); // 先停掉从 Reactor 线程
+    if (listenFd_ >= 0)
+    {
+        close(listenFd_);
+    }
     isClose_ = true;
     free(srcDir_);
     SqlConnPool::Instance()->ClosePool();
@@ -70,18 +97,24 @@ void WebServer::InitEventMode_(int trigMode)
 
 void WebServer::Start()
 {
-    int timeMS = -1; /* epoll wait timeout == -1 无事件将阻塞 */
     if (!isClose_)
     {
         LOG_INFO("========== Server start ==========");
     }
+    int cpuNum = static_cast<int>(std::thread::hardware_concurrency());
+    for (size_t i = 0; i < subReactors_.size(); i++)
+    {
+        // 绑核时第 i 个从 Reactor 固定在第 i % cpuNum 个 CPU 上
+        subReactors_[i]->Start(pinCpu_ && cpuNum > 0 ? static_cast<int>(i) % cpuNum : -1);
+    }
+    TimeStamp nextDepthLog = Clock::now() + std::chrono::seconds(DEPTH_LOG_INTERVAL_S);
     while (!isClose_)
     {
-        if (timeoutMS_ > 0)
+        int eventCnt = epoller_->Wait(conns_ ? conns_->WaitTimeout() : -1); /* -1 无事件将阻塞 */
+        if (conns_)
         {
-            timeMS = timer_->GetNextTick(); // 获取下一个事件剩余时间
+            conns_->UpdateNow();
         }
-        int eventCnt = epoller_->Wait(timeMS);
         for (int i = 0; i < eventCnt; i++)
         {
             /* 处理事件 */
@@ -91,88 +124,60 @@ void WebServer::Start()
             {
                 DealListen_();
             }
+            else if (fd == conns_->TimerFd())
+            {
+                conns_->Tick();
+            }
             else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
             {
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+                conns_->Close(conns_->Get(fd));
             }
             else if (events & EPOLLIN)
             {
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                DealRead_(conns_->Get(fd));
             }
             else if (events & EPOLLOUT)
             {
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                DealWrite_(conns_->Get(fd));
             }
             else
             {
                 std::cout << "Unexpected event" << std::endl;
             }
         }
+        threadpool_->AddTasks(batch_, batchKeys_);
+        if (affineDispatch_ && Clock::now() >= nextDepthLog)
+        {
+            // 亲和模式下任务不能被偷，定期记录积压，用来观察连接在工作线程间是否均衡
+            LogQueueDepth_();
+            nextDepthLog = Clock::now() + std::chrono::seconds(DEPTH_LOG_INTERVAL_S);
+        }
     }
 }
 
-void WebServer::SendError_(int fd, const char *info)
-{
-    assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);
-    close(fd);
-}
-
-void WebServer::CloseConn_(HttpConn *client)
-{
-    assert(client);
-    LOG_INFO("Client[%d] quit!", client->GetFd());
-    epoller_->DelFd(client->GetFd());
-    client->Close();
-}
-
-void WebServer::AddClient_(int fd, sockaddr_in addr)
+void WebServer::LogQueueDepth_()
 {
-    assert(fd > 0);
-    users_[fd].init(fd, addr);
-    char ip[24] = {0};
-    LOG_INFO("Connect from %s", inet_ntop(AF_INET, &addr.sin_addr.s_addr, ip, sizeof(ip)));
-    if (timeoutMS_ > 0)
+    std::string depth;
+    char item[32];
+    for (size_t i = 0; i < threadpool_->QueueCount(); i++)
     {
-        // 将新连接添加到定时器中
-        timer_->add(fd, timeoutMS_, [this, capture0 = &users_[fd]] { CloseConn_(capture0); });
+        snprintf(item, sizeof(item), " %zu/%zu", threadpool_->QueueDepth(i), threadpool_->MaxQueueDepth(i));
+        depth += item;
     }
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);
-    SetFdNonblock(fd);
+    LOG_INFO("Worker queue depth (now/max):%s", depth.c_str());
 }
 
 void WebServer::DealListen_()
 {
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-    do
-    {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
-        if (fd <= 0)
+    ConnManager::Accept(listenFd_, listenEvent_, [this](int fd, const sockaddr_in &addr) {
+        if (!subReactors_.empty())
         {
+            // 轮询分发给从 Reactor
+            subReactors_[nextReactor_++ % subReactors_.size()]->AddClient(fd, addr);
             return;
         }
-        else if (HttpConn::userCount >= MAX_FD)
-        {
-            SendError_(fd, "Server busy!");
-            LOG_WARN("Clients is full!");
-            return;
-        }
-        AddClient_(fd, addr);
-    } while (listenEvent_ & EPOLLET);
-}
-
-void WebServer::ExtentTime_(HttpConn *client)
-{
-    assert(client);
-    // 当连接有新的事件时更新定时器
-    if (timeoutMS_ > 0)
-    {
-        timer_->adjust(client->GetFd(), timeoutMS_);
-    }
+        conns_->Add(fd, addr);
+    });
 }
 
 void WebServer::DealRead_(HttpConn *client)
@@ -189,8 +194,9 @@ void WebServer::DealRead_(HttpConn *client)
     //     return;
     // }
     ///////////////////////////////////
-    ExtentTime_(client);
-    threadpool_->AddTask([this, client] { OnRead_(client); });
+    conns_->Extend(client);
+    batch_.emplace_back([this, client] { OnRead_(client); });
+    batchKeys_.push_back(client->GetFd());
 }
 
 void WebServer::DealWrite_(HttpConn *client)
@@ -215,32 +221,31 @@ void WebServer::DealWrite_(HttpConn *client)
     //     return;
     // }
     /////////////////////////////
-    ExtentTime_(client);
-    threadpool_->AddTask([this, client] { OnWrite_(client); });
+    conns_->Extend(client);
+    batch_.emplace_back([this, client] { OnWrite_(client); });
+    batchKeys_.push_back(client->GetFd());
 }
 
 void WebServer::OnRead_(HttpConn *client)
 {
     assert(client);
-
-    int ret = -1;
-    int readErrno = 0;
-    ret = client->read(&readErrno);
-    if (ret <= 0 && readErrno != EAGAIN)
+    if (conns_->Read(client))
     {
-        CloseConn_(client);
-        return;
+        OnProcess(client);
     }
-
-    OnProcess(client);
 }
 
 void WebServer::OnProcess(HttpConn *client)
 {
-    if (client->process())
+    if (client->process(true))
     {
         epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
     }
+    else if (client->VerifyPending())
+    {
+        // 遇到登录/注册请求，剩下的处理(含查库)转到校验线程池，当前工作线程去处理别的连接
+        verifyPool_->AddTask([this, client] { OnProcess(client); });
+    }
     else
     {
         epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
@@ -250,39 +255,54 @@ void WebServer::OnProcess(HttpConn *client)
 void WebServer::OnWrite_(HttpConn *client)
 {
     assert(client);
-    int ret = -1;
-    int writeErrno = 0;
-    ret = client->write(&writeErrno);
-    if (client->ToWriteBytes() == 0)
-    {
-        /* 传输完成 */
-        if (client->IsKeepAlive())
-        {
-            OnProcess(client);
-            return;
-        }
-    }
-    else if (ret < 0)
+    if (conns_->Write(client))
     {
-        if (writeErrno == EAGAIN)
-        { // 写缓冲区满了
-            /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
+        OnProcess(client);
     }
-    CloseConn_(client);
 }
 
 /* Create listenFd */
 bool WebServer::InitSocket_()
 {
-    int ret;
-    struct sockaddr_in addr;
     if (port_ > 65535 || port_ < 1024)
     {
         return false;
     }
+
+    if (reusePort_)
+    {
+        /* 分片模式: 每个从 Reactor 一个 SO_REUSEPORT 监听套接字，内核按四元组哈希把新连接分给它们 */
+        listenFd_ = -1;
+        for (auto &reactor : subReactors_)
+        {
+            int fd = CreateListenFd_();
+            if (fd < 0)
+            {
+                return false;
+            }
+            reactor->SetListenFd(fd, listenEvent_);
+        }
+        return true;
+    }
+
+    listenFd_ = CreateListenFd_();
+    if (listenFd_ < 0)
+    {
+        return false;
+    }
+    int ret = epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN);
+    if (ret == 0)
+    {
+        close(listenFd_);
+        return false;
+    }
+    return true;
+}
+
+int WebServer::CreateListenFd_()
+{
+    int ret;
+    struct sockaddr_in addr;
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(port_);
@@ -294,50 +314,51 @@ bool WebServer::InitSocket_()
         optLinger.l_linger = 1;
     }
 
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0)
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0)
     {
-        return false;
+        return -1;
     }
 
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if (ret < 0)
     {
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
     if (ret == -1)
     {
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
-    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
-    if (ret < 0)
+    /* SO_REUSEPORT: 多个套接字绑定同一端口，各自拥有独立的 accept 队列 */
+    if (reusePort_ && setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void *)&optval, sizeof(int)) == -1)
     {
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
-    ret = listen(listenFd_, 6);
+    ret = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
     if (ret < 0)
     {
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
-    ret = epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN);
-    if (ret == 0)
+
+    ret = listen(listenFd, backlog_);
+    if (ret < 0)
     {
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
-    SetFdNonblock(listenFd_);
-    return true;
+    SetFdNonblock(listenFd);
+    return listenFd;
 }
 
 int WebServer::SetFdNonblock(int fd)
@@ -12,58 +12,75 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h> // close()
-#include <unordered_map>
+#include <vector>
 
 #include "../http/http_connect.h"
 #include "../pool/threadpool.h"
-#include "../timer/heaptimer.h"
+#include "../pool/workstealpool.h"
+#include "connmanager.h"
 #include "epoller.h"
+#include "subreactor.h"
 
 class WebServer
 {
   public:
     WebServer(int port, int trigMode, int timeoutMS, bool OptLinger, int sqlPort, const char *sqlUser,
               const char *sqlPwd, const char *dbName, int connPoolNum, int threadNum, bool openLog, int logLevel,
-              int logQueSize);
+              int logQueSize, int subReactorNum = 0, bool reusePort = false, int backlog = 6, bool pinCpu = false,
+              int lazyTickMS = 0, bool affineDispatch = false);
 
     ~WebServer();
     void Start();
 
   private:
     bool InitSocket_();
+    int CreateListenFd_();
     void InitEventMode_(int trigMode);
-    void AddClient_(int fd, sockaddr_in addr);
 
     void DealListen_();
     void DealWrite_(HttpConn *client);
     void DealRead_(HttpConn *client);
 
-    void SendError_(int fd, const char *info);
-    void ExtentTime_(HttpConn *client);
-    void CloseConn_(HttpConn *client);
-
     void OnRead_(HttpConn *client);
     void OnWrite_(HttpConn *client);
     void OnProcess(HttpConn *client);
 
-    static const int MAX_FD = 65536;
+    void LogQueueDepth_(); // 亲和模式下记录各工作线程收件箱的当前/最大积压
 
     static int SetFdNonblock(int fd);
 
+    static constexpr int DEPTH_LOG_INTERVAL_S = 10;
+
     int port_;
     bool openLinger_;
     int timeoutMS_; /* 毫秒MS */
     bool isClose_;
-    int listenFd_;
+    int listenFd_; /* 分片模式下为 -1，监听套接字归各从 Reactor 所有 */
+    bool reusePort_;
+    int backlog_;
+    bool pinCpu_;
+    bool affineDispatch_;
     char *srcDir_;
 
+    /* lazyTickMS_ > 0 时为惰性超时模式: I/O 只给连接打上活跃时间，由 timerfd 每 lazyTickMS_ 毫秒驱动一次时间轮，
+       到期的连接如果期间活跃过就按剩余时间重新挂上，否则关闭 */
+    int lazyTickMS_;
+
     uint32_t listenEvent_;
     uint32_t connEvent_;
 
-    std::unordered_map<int, HttpConn> users_;
     std::unique_ptr<Epoller> epoller_;
-    std::unique_ptr<ThreadPool> threadpool_;
-    std::unique_ptr<HeapTimer> timer_;
+    std::unique_ptr<ConnManager> conns_; // 单 Reactor 模式的连接表和定时器，从 Reactor 模式下不用
+    std::unique_ptr<WorkStealingPool> threadpool_;
+    /* 登录/注册要查 MySQL，放到单独的线程池里做，不和静态文件请求抢工作线程；
+       线程数与 SQL 连接数相同，多了也只是阻塞在取连接上 */
+    std::unique_ptr<ThreadPool> verifyPool_;
+    std::vector<Task> batch_; // 本轮 epoll_wait 产生的任务，循环结束后一次提交
+    std::vector<int> batchKeys_; // batch_ 中每个任务所属连接的 fd，亲和模式下据此选工作线程
+
+    /* subReactorNum > 0 时启用 one loop per thread 模式，主线程只负责 accept */
+    std::vector<std::unique_ptr<SubReactor>> subReactors_;
+    size_t nextReactor_;
 };
 
 #endif
\ No newline at end of file
@@ -22,7 +22,7 @@ void HeapTimer::siftup_(size_t i)
 {
     assert(i >= 0 && i < heap_.size());
     size_t j = (i - 1) / 2;
-    while (j >= 0 && i > 0 && heap_[j] < heap_[i])
+    while (j >= 0 && i > 0 && heap_[i] < heap_[j])
     {
         SwapNode_(i, j);
         i = j;
@@ -112,8 +112,12 @@ void HeapTimer::adjust(int id, int timeout)
 {
     /* 调整指定id的结点 */
     assert(!heap_.empty() && ref_.count(id) > 0);
-    heap_[ref_[id]].expires = Clock::now() + MS(timeout);
-    siftdown_(ref_[id], heap_.size());
+    size_t i = ref_[id];
+    heap_[i].expires = Clock::now() + MS(timeout);
+    if (!siftdown_(i, heap_.size()))
+    {
+        siftup_(i);
+    }
 }
 
 void HeapTimer::tick()
@@ -0,0 +1,205 @@
+#include "timewheel.h"
+
+TimeWheel::TimeWheel() : start_(Clock::now()), cur_(0), count_(0)
+{
+    for (int i = 0; i < SLOTS; i++)
+    {
+        head_[i] = -1;
+    }
+}
+
+int64_t TimeWheel::Now_() const
+{
+    return std::chrono::duration_cast<MS>(Clock::now() - start_).count();
+}
+
+// 按剩余刻度选层，层内按到期刻度的对应位选槽
+void TimeWheel::Link_(int id)
+{
+    Node &node = nodes_[id];
+    if (node.expires < cur_)
+    {
+        node.expires = cur_; // 已经过期的放到下一个要处理的槽
+    }
+    int64_t span = node.expires - cur_;
+    if (span > MAX_SPAN)
+    {
+        span = MAX_SPAN;
+        node.expires = cur_ + MAX_SPAN;
+    }
+    int slot;
+    if (span < ROOT_SIZE)
+    {
+        slot = node.expires & (ROOT_SIZE - 1);
+    }
+    else
+    {
+        int level = 1;
+        while (span >= (1LL << (ROOT_BITS + level * LEVEL_BITS)))
+        {
+            level++;
+        }
+        int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+        slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + ((node.expires >> shift) & (LEVEL_SIZE - 1));
+    }
+    node.slot = slot;
+    node.prev = -1;
+    node.next = head_[slot];
+    if (node.next >= 0)
+    {
+        nodes_[node.next].prev = id;
+    }
+    head_[slot] = id;
+}
+
+void TimeWheel::Unlink_(int id)
+{
+    Node &node = nodes_[id];
+    if (node.prev >= 0)
+    {
+        nodes_[node.prev].next = node.next;
+    }
+    else
+    {
+        head_[node.slot] = node.next;
+    }
+    if (node.next >= 0)
+    {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.slot = -1;
+}
+
+// 把第 level 层 index 槽的定时器重新挂到低层，返回 index，为 0 说明这一层也转完一圈，需要继续 cascade 上一层
+int TimeWheel::Cascade_(int level, int index)
+{
+    int slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + index;
+    int id = head_[slot];
+    head_[slot] = -1;
+    while (id >= 0)
+    {
+        int next = nodes_[id].next;
+        Link_(id);
+        id = next;
+    }
+    return index;
+}
+
+void TimeWheel::add(int id, int timeout, const TimeoutCallBack &cb)
+{
+    assert(id >= 0);
+    if (static_cast<size_t>(id) >= nodes_.size())
+    {
+        nodes_.resize(id + 1, {0, nullptr, -1, -1, -1});
+    }
+    Node &node = nodes_[id];
+    if (node.slot >= 0)
+    {
+        Unlink_(id);
+    }
+    else
+    {
+        count_++;
+    }
+    node.cb = cb;
+    node.expires = Now_() + timeout;
+    Link_(id);
+}
+
+void TimeWheel::adjust(int id, int timeout)
+{
+    /* 调整指定id的结点 */
+    assert(static_cast<size_t>(id) < nodes_.size() && nodes_[id].slot >= 0);
+    Unlink_(id);
+    nodes_[id].expires = Now_() + timeout;
+    Link_(id);
+}
+
+void TimeWheel::doWork(int id)
+{
+    /* 删除指定id结点，并触发回调函数 */
+    if (id < 0 || static_cast<size_t>(id) >= nodes_.size() || nodes_[id].slot < 0)
+    {
+        return;
+    }
+    TimeoutCallBack cb;
+    cb.swap(nodes_[id].cb);
+    Unlink_(id);
+    count_--;
+    cb();
+}
+
+void TimeWheel::cancel(int id)
+{
+    if (id < 0 || static_cast<size_t>(id) >= nodes_.size() || nodes_[id].slot < 0)
+    {
+        return;
+    }
+    Unlink_(id);
+    nodes_[id].cb = nullptr;
+    count_--;
+}
+
+void TimeWheel::clear()
+{
+    nodes_.clear();
+    for (int i = 0; i < SLOTS; i++)
+    {
+        head_[i] = -1;
+    }
+    count_ = 0;
+}
+
+void TimeWheel::tick()
+{
+    /* 处理到当前时刻为止的所有刻度 */
+    int64_t now = Now_();
+    while (cur_ <= now)
+    {
+        if (count_ == 0)
+        {
+            cur_ = now + 1; // 没有定时器，直接跳到当前时刻
+            break;
+        }
+        int index = cur_ & (ROOT_SIZE - 1);
+        if (index == 0)
+        {
+            for (int level = 1; level < LEVELS; level++)
+            {
+                int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+                if (Cascade_(level, (cur_ >> shift) & (LEVEL_SIZE - 1)) != 0)
+                {
+                    break;
+                }
+            }
+        }
+        /* 每次从链表头摘一个再触发，回调里增删别的定时器也不会破坏遍历 */
+        while (head_[index] >= 0)
+        {
+            int id = head_[index];
+            TimeoutCallBack cb;
+            cb.swap(nodes_[id].cb);
+            Unlink_(id);
+            count_--;
+            cb();
+        }
+        cur_++;
+    }
+}
+
+int TimeWheel::GetNextTick()
+{
+    tick();
+    if (count_ == 0)
+    {
+        return -1;
+    }
+    int64_t now = Now_();
+    /* 在第 0 层里找下一个非空槽，最远找到下一次 cascade 为止 */
+    int64_t t = cur_;
+    while ((t & (ROOT_SIZE - 1)) != 0 && head_[t & (ROOT_SIZE - 1)] < 0)
+    {
+        t++;
+    }
+    return t > now ? static_cast<int>(t - now) : 0;
+}
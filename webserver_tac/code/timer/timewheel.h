@@ -0,0 +1,77 @@
+#ifndef TIME_WHEEL_H
+#define TIME_WHEEL_H
+
+#include <assert.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "heaptimer.h" // TimeoutCallBack, Clock, MS
+
+// 分层时间轮，接口与 HeapTimer 相同，用来管理连接超时
+// 刻度为 1ms，共 4 层: 第 0 层 256 个槽覆盖 256ms，之后每层 64 个槽，依次覆盖 16s、17min、18h，更远的按 18h 处理；
+// 走到第 0 层的起点时把上一层对应槽里的定时器重新分配下来(cascade)。
+// 结点按 id 存在数组里，槽是结点下标串起来的侵入式双向链表，add/adjust/cancel 都只是摘链 + 挂链，O(1)，不分配内存。
+class TimeWheel
+{
+  public:
+    TimeWheel();
+
+    ~TimeWheel()
+    {
+        clear();
+    }
+
+    void adjust(int id, int newExpires);
+
+    void add(int id, int timeOut, const TimeoutCallBack &cb);
+
+    void doWork(int id); // 立即触发并删除
+
+    void cancel(int id); // 删除但不触发
+
+    void clear();
+
+    void tick();
+
+    // 距下一个到期定时器的毫秒数，没有定时器时返回 -1；
+    // 最近的定时器还在高层时，最多返回到下一次 cascade 的时间(不超过 256ms)
+    int GetNextTick();
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+  private:
+    struct Node
+    {
+        int64_t expires; // 到期刻度
+        TimeoutCallBack cb;
+        int prev;
+        int next;
+        int slot; // 所在槽，-1 表示没有定时器
+    };
+
+    int64_t Now_() const;
+    void Link_(int id);
+    void Unlink_(int id);
+    int Cascade_(int level, int index);
+
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int ROOT_SIZE = 1 << ROOT_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const int LEVELS = 4;
+    static const int SLOTS = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+    static const int64_t MAX_SPAN = (1LL << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+
+    TimeStamp start_;
+    int64_t cur_; // 下一个要处理的刻度
+    size_t count_;
+    std::vector<Node> nodes_; // 按 id 索引
+    int head_[SLOTS];         // 每个槽的链表头，-1 表示空
+};
+
+#endif // TIME_WHEEL_H
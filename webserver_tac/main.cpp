@@ -1,10 +1,19 @@
 #include "code/server/webserver.h"
+#include <stdlib.h>
 #include <unistd.h>
 
-int main()
+int main(int argc, char *argv[])
 {
+    // 可选参数：从 Reactor 个数(0 为默认的 Reactor + 线程池模式)、是否 SO_REUSEPORT 分片、listen backlog、是否绑核、
+    // 惰性超时的扫描周期(毫秒，0 为每次 I/O 精确调整定时器)、是否按 fd 把连接固定到工作线程
+    int subReactorNum = argc > 1 ? atoi(argv[1]) : 0;
+    bool reusePort = argc > 2 ? atoi(argv[2]) != 0 : false;
+    int backlog = argc > 3 ? atoi(argv[3]) : 6;
+    bool pinCpu = argc > 4 ? atoi(argv[4]) != 0 : false;
+    int lazyTickMS = argc > 5 ? atoi(argv[5]) : 0;
+    bool affineDispatch = argc > 6 ? atoi(argv[6]) != 0 : false;
     WebServer server(8080, 3, 60000, true,
     3306,"root","123890","user",
-    16,16,false,1,1024);
+    16,16,false,1,1024,subReactorNum,reusePort,backlog,pinCpu,lazyTickMS,affineDispatch);
     server.Start();
 }
\ No newline at end of file
@@ -0,0 +1,356 @@
+// 二进制日志解码器：把 Log 二进制模式写出的文件还原成和文本模式一样的行，输出到标准输出。
+// 记录格式见 code/log/binlog.h。格式串里的长度修饰符(l、ll、z 等)按记录里实际保存的参数类型重新生成，
+// 所以参数的宽度和格式串写得不一致也能正确输出。
+// 用法: log_decoder 日志文件...
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+#include "../code/log/binlog.h"
+
+struct Format
+{
+    int level;
+    int line;
+    std::string signature;
+    std::string file;
+    std::string format;
+};
+
+struct Arg
+{
+    char tag;
+    long long i; // 整数、指针
+    double d;
+    std::string s;
+};
+
+static const char *TITLES[] = {"[debug]: ", "[info] : ", "[warn] : ", "[error]: "};
+
+// 从 p 开始读一个 T，越界返回 false
+template <class T> static bool Read(const char *&p, const char *end, T &v)
+{
+    if (end - p < static_cast<long>(sizeof(T)))
+    {
+        return false;
+    }
+    memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+static bool ReadArgs(const char *p, const char *end, const std::string &signature, std::vector<Arg> &args)
+{
+    args.clear();
+    for (char tag : signature)
+    {
+        Arg a = {tag, 0, 0.0, std::string()};
+        bool ok = true;
+        switch (tag)
+        {
+        case 'i': {
+            int32_t v;
+            ok = Read(p, end, v);
+            a.i = v;
+            break;
+        }
+        case 'I': {
+            int64_t v;
+            ok = Read(p, end, v);
+            a.i = v;
+            break;
+        }
+        case 'u': {
+            uint32_t v;
+            ok = Read(p, end, v);
+            a.i = v;
+            break;
+        }
+        case 'U':
+        case 'p': {
+            uint64_t v;
+            ok = Read(p, end, v);
+            a.i = static_cast<long long>(v);
+            break;
+        }
+        case 'd':
+            ok = Read(p, end, a.d);
+            a.i = static_cast<long long>(a.d);
+            break;
+        case 's': {
+            uint16_t len;
+            ok = Read(p, end, len) && end - p >= len;
+            if (ok)
+            {
+                a.s.assign(p, len);
+                p += len;
+            }
+            break;
+        }
+        default:
+            ok = false;
+        }
+        if (!ok)
+        {
+            return false;
+        }
+        args.push_back(a);
+    }
+    return true;
+}
+
+// 按参数记录时的宽度截断整数，再按 h/hh 截断，与文本模式下 printf 看到的值一致
+static long long NarrowInt(const Arg &a, char conv, int halves)
+{
+    long long v = a.tag == 'd' ? static_cast<long long>(a.d) : a.i;
+    const bool narrow = a.tag == 'i' || a.tag == 'u';
+    if (strchr("ouxX", conv))
+    {
+        unsigned long long u = narrow ? static_cast<uint32_t>(v) : static_cast<unsigned long long>(v);
+        if (halves == 1)
+        {
+            u = static_cast<unsigned short>(u);
+        }
+        else if (halves >= 2)
+        {
+            u = static_cast<unsigned char>(u);
+        }
+        return static_cast<long long>(u);
+    }
+    if (narrow)
+    {
+        v = static_cast<int32_t>(v);
+    }
+    if (halves == 1)
+    {
+        v = static_cast<short>(v);
+    }
+    else if (halves >= 2)
+    {
+        v = static_cast<signed char>(v);
+    }
+    return v;
+}
+
+// 按一个转换说明格式化一个参数。spec 是去掉长度修饰符的 "%..."，halves 是原格式里 'h' 的个数，stars 是 '*' 取到的宽度/精度
+static void FormatOne(std::string &out, std::string spec, char conv, int halves, const std::vector<int> &stars,
+                      const Arg &a)
+{
+    char buf[512];
+    int n = 0;
+    const bool isInt = a.tag != 's' && a.tag != 'd';
+    if (strchr("diouxX", conv))
+    {
+        spec += "ll";
+        spec += conv;
+        long long v = NarrowInt(a, conv, halves);
+        n = stars.size() == 0   ? snprintf(buf, sizeof(buf), spec.c_str(), v)
+            : stars.size() == 1 ? snprintf(buf, sizeof(buf), spec.c_str(), stars[0], v)
+                                : snprintf(buf, sizeof(buf), spec.c_str(), stars[0], stars[1], v);
+    }
+    else if (strchr("eEfFgGaA", conv))
+    {
+        spec += conv;
+        double v = isInt ? static_cast<double>(a.i) : a.d;
+        n = stars.size() == 0   ? snprintf(buf, sizeof(buf), spec.c_str(), v)
+            : stars.size() == 1 ? snprintf(buf, sizeof(buf), spec.c_str(), stars[0], v)
+                                : snprintf(buf, sizeof(buf), spec.c_str(), stars[0], stars[1], v);
+    }
+    else if (conv == 'c')
+    {
+        spec += conv;
+        int v = static_cast<int>(a.i);
+        n = stars.size() == 0 ? snprintf(buf, sizeof(buf), spec.c_str(), v)
+                              : snprintf(buf, sizeof(buf), spec.c_str(), stars[0], v);
+    }
+    else if (conv == 'p')
+    {
+        spec += conv;
+        n = snprintf(buf, sizeof(buf), spec.c_str(), reinterpret_cast<void *>(a.i));
+    }
+    else if (conv == 's')
+    {
+        // 字符串可能比 buf 长，不带宽度精度时直接追加
+        if (a.tag != 's')
+        {
+            out += "(?)";
+            return;
+        }
+        if (spec == "%")
+        {
+            out += a.s;
+            return;
+        }
+        spec += conv;
+        n = stars.size() == 0   ? snprintf(buf, sizeof(buf), spec.c_str(), a.s.c_str())
+            : stars.size() == 1 ? snprintf(buf, sizeof(buf), spec.c_str(), stars[0], a.s.c_str())
+                                : snprintf(buf, sizeof(buf), spec.c_str(), stars[0], stars[1], a.s.c_str());
+    }
+    if (n > 0)
+    {
+        out.append(buf, std::min(n, static_cast<int>(sizeof(buf)) - 1));
+    }
+}
+
+static std::string Render(const std::string &format, const std::vector<Arg> &args)
+{
+    std::string out;
+    size_t next = 0;
+    for (size_t i = 0; i < format.size(); i++)
+    {
+        if (format[i] != '%')
+        {
+            out += format[i];
+            continue;
+        }
+        if (i + 1 < format.size() && format[i + 1] == '%')
+        {
+            out += '%';
+            i++;
+            continue;
+        }
+        std::string spec = "%";
+        std::vector<int> stars;
+        int halves = 0;
+        size_t j = i + 1;
+        for (; j < format.size(); j++)
+        {
+            char c = format[j];
+            if (c == '*')
+            {
+                stars.push_back(next < args.size() ? static_cast<int>(args[next++].i) : 0);
+                spec += c;
+            }
+            else if (strchr("-+ #0'.123456789", c))
+            {
+                spec += c;
+            }
+            else if (c == 'h')
+            {
+                halves++;
+            }
+            else if (!strchr("lLqjzt", c)) // 长度修饰符丢掉，按实际类型重新生成；h/hh 记下来用于截断
+            {
+                break;
+            }
+        }
+        if (j == format.size())
+        {
+            break;
+        }
+        char conv = format[j];
+        i = j;
+        if (conv == 'n')
+        {
+            next++;
+            continue;
+        }
+        if (next >= args.size())
+        {
+            out += "(missing)";
+            continue;
+        }
+        FormatOne(out, spec, conv, halves, stars, args[next++]);
+    }
+    return out;
+}
+
+static bool DecodeFile(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == nullptr)
+    {
+        perror(path);
+        return false;
+    }
+    std::string data;
+    char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        data.append(chunk, got);
+    }
+    fclose(fp);
+
+    std::unordered_map<uint32_t, Format> formats;
+    std::vector<Arg> args;
+    const char *p = data.data();
+    const char *end = p + data.size();
+    while (end - p >= 8)
+    {
+        uint32_t len, id;
+        memcpy(&len, p, 4);
+        memcpy(&id, p + 4, 4);
+        if (len < 8 || static_cast<long>(len) > end - p)
+        {
+            fprintf(stderr, "%s: corrupt record at offset %ld\n", path, static_cast<long>(p - data.data()));
+            return false;
+        }
+        const char *body = p + 8;
+        const char *recEnd = p + len;
+        p = recEnd;
+
+        if (id == binlog::DEF_ID)
+        {
+            uint32_t head[3];
+            if (!Read(body, recEnd, head))
+            {
+                continue;
+            }
+            Format f;
+            f.level = head[1];
+            f.line = head[2];
+            // 三个以 '\0' 结尾的字符串
+            std::string *fields[] = {&f.signature, &f.file, &f.format};
+            for (std::string *field : fields)
+            {
+                const char *zero = static_cast<const char *>(memchr(body, '\0', recEnd - body));
+                if (zero == nullptr)
+                {
+                    break;
+                }
+                field->assign(body, zero - body);
+                body = zero + 1;
+            }
+            formats[head[0]] = f;
+            continue;
+        }
+
+        uint64_t timeUs;
+        auto it = formats.find(id);
+        if (!Read(body, recEnd, timeUs) || it == formats.end() ||
+            !ReadArgs(body, recEnd, it->second.signature, args))
+        {
+            fprintf(stderr, "%s: undecodable record (id %u)\n", path, id);
+            continue;
+        }
+        time_t sec = static_cast<time_t>(timeUs / 1000000);
+        struct tm t;
+        localtime_r(&sec, &t);
+        int level = it->second.level;
+        printf("%d-%02d-%02d %02d:%02d:%02d.%06ld %s%s\n", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour,
+               t.tm_min, t.tm_sec, static_cast<long>(timeUs % 1000000), TITLES[level >= 0 && level <= 3 ? level : 1],
+               Render(it->second.format, args).c_str());
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s logfile...\n", argv[0]);
+        return 1;
+    }
+    bool ok = true;
+    for (int i = 1; i < argc; i++)
+    {
+        ok = DecodeFile(argv[i]) && ok;
+    }
+    return ok ? 0 : 1;
+}